@@ -0,0 +1,1679 @@
+/*
+ **  wdlfft-tests: regression driver for wdlfft.h and the wdlfft_*.h headers
+ **
+ **  C++ wrapper (C)2024 DEMOS
+ **  GITHUB: https://github.com/mewza or Email: subband@protonmail.com
+ **  LICENSE: same as wdlfft.h
+ **
+ **  Build and run from the repo root, once per table mode:
+ **
+ **    c++ -std=c++17 -O2 -pthread -I. tests/wdlfft_tests.cpp -o wdlfft-tests
+ **    ./wdlfft-tests
+ **
+ **    c++ -std=c++17 -O2 -pthread -I. -DWDL_FFT_CONSTEXPR_TABLES -fconstexpr-ops-limit=1000000000 \
+ **        -DWDL_FFT_STATS tests/wdlfft_tests.cpp -o wdlfft-tests-ct    (clang: -fconstexpr-steps=1000000000)
+ **    ./wdlfft-tests-ct
+ **
+ **  The second build also turns on WDL_FFT_STATS, which adds the stats
+ **  test and runs everything else with the counters compiled in.
+ **
+ **  Usage: wdlfft-tests [-full] [name...]. With names only those tests
+ **  run. The reference DFT check stops at 4096 points unless -full is
+ **  given (32768 takes about a minute per type). Each test prints one
+ **  line; the exit status is 0 only if every test passed.
+ **
+ **  Lane-batched paths run on test_vec, a plain array-backed vector type
+ **  defined below, so they are checked on every platform. simd_float4 /
+ **  simd_double2 go through the reference checks as well when
+ **  <simd/simd.h> is on the include path.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <type_traits>
+
+#ifndef F_COS
+#define F_COS cos
+#define F_SIN sin
+#endif
+
+/*
+ * Portable stand-in for the simd_floatN / simd_doubleN types: N lanes
+ * with element-wise arithmetic, scalar broadcast and cos/sin. It stays
+ * trivially copyable; the template constructor and assignment only
+ * serve the volatile loads in the butterfly macros.
+ */
+template <typename S, int32_t N>
+struct test_vec {
+    S v[N];
+
+    test_vec() = default;
+    test_vec(S s) { for (int32_t i = 0; i < N; i ++) v[i] = s; }
+
+    template <typename U, typename = typename std::enable_if<std::is_same<U, test_vec>::value>::type>
+    test_vec(const volatile U &o) { for (int32_t i = 0; i < N; i ++) v[i] = o.v[i]; }
+
+    template <typename U, typename = typename std::enable_if<std::is_same<U, test_vec>::value>::type>
+    test_vec &operator=(const volatile U &o) { for (int32_t i = 0; i < N; i ++) v[i] = o.v[i]; return *this; }
+
+    S &operator[](int32_t i) { return v[i]; }
+    const S &operator[](int32_t i) const { return v[i]; }
+
+    test_vec operator-() const { test_vec r; for (int32_t i = 0; i < N; i ++) r.v[i] = -v[i]; return r; }
+
+#define TEST_VEC_OP(op)                                                                                     \
+    test_vec operator op(const test_vec &b) const { test_vec r; for (int32_t i = 0; i < N; i ++) r.v[i] = v[i] op b.v[i]; return r; } \
+    test_vec &operator op##=(const test_vec &b) { for (int32_t i = 0; i < N; i ++) v[i] op##= b.v[i]; return *this; }   \
+    friend test_vec operator op(S a, const test_vec &b) { return test_vec(a) op b; }
+    TEST_VEC_OP(+) TEST_VEC_OP(-) TEST_VEC_OP(*) TEST_VEC_OP(/)
+#undef TEST_VEC_OP
+};
+
+template <typename S, int32_t N> static test_vec<S, N> cos(const test_vec<S, N> &a)
+{
+    test_vec<S, N> r;
+    for (int32_t i = 0; i < N; i ++) r.v[i] = cos(a.v[i]);
+    return r;
+}
+
+template <typename S, int32_t N> static test_vec<S, N> sin(const test_vec<S, N> &a)
+{
+    test_vec<S, N> r;
+    for (int32_t i = 0; i < N; i ++) r.v[i] = sin(a.v[i]);
+    return r;
+}
+
+typedef test_vec<float, 4> test_float4;
+typedef test_vec<float, 8> test_float8;
+typedef test_vec<float, 16> test_float16;
+typedef test_vec<double, 2> test_double2;
+typedef test_vec<double, 4> test_double4;
+
+/* counted instead of aborting, so the arena test can see the failure path */
+static int32_t g_alloc_fails = 0;
+#define WDL_FFT_ALLOC_FAIL() (g_alloc_fails ++)
+
+#include "wdlfft.h"
+#include "wdlfft_reference.h"
+#include "wdlfft_bluestein.h"
+#include "wdlfft_dct.h"
+#include "wdlfft_nd.h"
+#include "wdlfft_lanes.h"
+#include "wdlfft_plan.h"
+#include "wdlfft_fixed.h"
+#include "wdlfft_pfb.h"
+#include "wdlfft_pvoc.h"
+#include "wdlfft_cqt.h"
+#include "wdlfft_welch.h"
+#include "wdlfft_hilbert.h"
+#include "wdlfft_ooc.h"
+#include "wdlfft_offload.h"
+#include "wdlfft_bigmul.h"
+
+#if defined(__has_include)
+#if __has_include(<simd/simd.h>)
+#define WDLFFT_TESTS_SIMD
+#endif
+#endif
+
+DECL_WDLFFT(float)
+
+static int32_t g_max_len = 4096;
+
+/* counts and reports a failed condition; tests return the count */
+#define EXPECT(cond, ...)                                           \
+    do {                                                            \
+        if (!(cond))                                                \
+        {                                                           \
+            printf("    FAIL %s:%d: ", __FILE__, __LINE__);         \
+            printf(__VA_ARGS__);                                    \
+            printf("\n");                                           \
+            fails ++;                                               \
+        }                                                           \
+    } while (0)
+
+/* uniform in [-1, 1), same sequence everywhere */
+static double test_rand(uint32_t *seed)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return (double)((int32_t)(*seed >> 8) - (1 << 23)) / (double)(1 << 23);
+}
+
+/* out[k] = sum in[j] * exp(-+2*pi*i*j*k/n) in long double, any n */
+static void test_dft(cmplxT<double> *out, const cmplxT<double> *in, int32_t n, int32_t isInverse)
+{
+    const long double sgn = isInverse ? 1.0L : -1.0L;
+    int32_t j, k;
+    for (k = 0; k < n; k ++)
+    {
+        long double re = 0, im = 0;
+        for (j = 0; j < n; j ++)
+        {
+            const long double a = sgn * 2.0L * (long double) M_PI * (long double)(((int64_t) j * k) % n) / n;
+            re += in[j].re * cosl(a) - in[j].im * sinl(a);
+            im += in[j].re * sinl(a) + in[j].im * cosl(a);
+        }
+        out[k].re = (double) re;
+        out[k].im = (double) im;
+    }
+}
+
+/* max |a - b| / max |b| */
+static double test_err(const cmplxT<double> *a, const cmplxT<double> *b, int32_t n)
+{
+    double e = 0, m = 0;
+    int32_t i;
+    for (i = 0; i < n; i ++)
+    {
+        e = fmax(e, hypot(a[i].re - b[i].re, a[i].im - b[i].im));
+        m = fmax(m, hypot(b[i].re, b[i].im));
+    }
+    return m > 0 ? e / m : e;
+}
+
+/* every transform against the long double DFT */
+static int32_t test_reference()
+{
+    int32_t fails = 0;
+    WDLFFT<float>::WDL_fft_init();
+    WDLFFT<double>::WDL_fft_init();
+    EXPECT(!WDLFFT_Reference<float>::run_all(0, g_max_len), "float reference checks");
+    EXPECT(!WDLFFT_Reference<double>::run_all(0, g_max_len), "double reference checks");
+    WDLFFT<test_float4>::WDL_fft_init();
+    WDLFFT<test_double2>::WDL_fft_init();
+    EXPECT(!WDLFFT_Reference<test_float4>::run_all(0, g_max_len), "test_float4 reference checks");
+    EXPECT(!WDLFFT_Reference<test_double2>::run_all(0, g_max_len), "test_double2 reference checks");
+#ifdef WDLFFT_TESTS_SIMD
+    WDLFFT<simd_float4>::WDL_fft_init();
+    WDLFFT<simd_double2>::WDL_fft_init();
+    EXPECT(!WDLFFT_Reference<simd_float4>::run_all(0, g_max_len), "simd_float4 reference checks");
+    EXPECT(!WDLFFT_Reference<simd_double2>::run_all(0, g_max_len), "simd_double2 reference checks");
+#endif
+    return fails;
+}
+
+/* arbitrary lengths against the DFT, both directions; plans are not copyable */
+static int32_t test_bluestein()
+{
+    static const int32_t lens[] = { 1, 2, 3, 5, 7, 12, 100, 257, 1000, 3001 };
+    int32_t fails = 0, i, j, inv;
+    uint32_t seed = 26;
+    WDLFFT<double>::WDL_fft_init();
+    WDLFFT_Bluestein<double> bs;
+
+    static_assert(!std::is_copy_constructible< WDLFFT_Bluestein<double> >::value, "plan cache must not be copied");
+    static_assert(!std::is_copy_assignable< WDLFFT_Bluestein<double> >::value, "plan cache must not be copied");
+
+    for (i = 0; i < (int32_t)(sizeof(lens) / sizeof(lens[0])); i ++)
+    {
+        const int32_t n = lens[i];
+        cmplxT<double> *x = new cmplxT<double>[n], *y = new cmplxT<double>[n], *r = new cmplxT<double>[n];
+        for (inv = 0; inv < 2; inv ++)
+        {
+            for (j = 0; j < n; j ++)
+            {
+                x[j].re = test_rand(&seed);
+                x[j].im = test_rand(&seed);
+                y[j] = x[j];
+            }
+            test_dft(r, x, n, inv);
+            EXPECT(bs.fft(y, n, inv) == 0, "fft(%d) failed", n);
+            const double e = test_err(y, r, n);
+            EXPECT(e < 1e-12, "len %d %s: error %g", n, inv ? "inverse" : "forward", e);
+        }
+        delete [] x;
+        delete [] y;
+        delete [] r;
+    }
+    EXPECT(bs.fft(0, WDLFFT_Bluestein<double>::MAX_LEN + 1, 0) == -1, "oversized length accepted");
+    return fails;
+}
+
+/* DCT-II/III/IV and MDCT against their sums, inverse pairs */
+static int32_t test_dct()
+{
+    static const int32_t lens[] = { 4, 16, 64, 512 };
+    int32_t fails = 0, i, j, k;
+    uint32_t seed = 27;
+    WDLFFT<double>::WDL_fft_init();
+
+    static_assert(!std::is_copy_constructible< WDLFFT_DCT<double> >::value, "tables must not be copied");
+
+    for (i = 0; i < (int32_t)(sizeof(lens) / sizeof(lens[0])); i ++)
+    {
+        const int32_t n = lens[i];
+        WDLFFT_DCT<double> dct;
+        double *x = new double[2 * n], *y = new double[2 * n], *z = new double[2 * n];
+        double e2 = 0, e4 = 0, em = 0, er = 0;
+
+        EXPECT(dct.init(n), "init(%d)", n);
+        for (j = 0; j < 2 * n; j ++) x[j] = test_rand(&seed);
+
+        dct.dct2(x, y);
+        for (k = 0; k < n; k ++)
+        {
+            long double r = 0;
+            for (j = 0; j < n; j ++) r += x[j] * cosl((long double) M_PI * (2 * j + 1) * k / (2.0L * n));
+            e2 = fmax(e2, fabs(y[k] - (double) r));
+        }
+        dct.dct3(y, z);
+        for (j = 0; j < n; j ++) er = fmax(er, fabs(z[j] - 0.5 * n * x[j]));
+
+        dct.dct4(x, y);
+        for (k = 0; k < n; k ++)
+        {
+            long double r = 0;
+            for (j = 0; j < n; j ++) r += x[j] * cosl((long double) M_PI * (2 * j + 1) * (2 * k + 1) / (4.0L * n));
+            e4 = fmax(e4, fabs(y[k] - (double) r));
+        }
+
+        dct.mdct(x, y);
+        for (k = 0; k < n; k ++)
+        {
+            long double r = 0;
+            for (j = 0; j < 2 * n; j ++) r += x[j] * cosl((long double) M_PI / n * (j + 0.5L + n / 2.0L) * (k + 0.5L));
+            em = fmax(em, fabs(y[k] - (double) r));
+        }
+        dct.imdct(y, z);
+        for (j = 0; j < 2 * n; j ++)
+        {
+            long double r = 0;
+            for (k = 0; k < n; k ++) r += y[k] * cosl((long double) M_PI / n * (j + 0.5L + n / 2.0L) * (k + 0.5L));
+            em = fmax(em, fabs(z[j] - (double) r));
+        }
+
+        EXPECT(e2 < 1e-11 * n && e4 < 1e-11 * n && em < 1e-11 * n && er < 1e-11 * n,
+               "n %d: dct2 %g dct4 %g mdct/imdct %g dct3(dct2) %g", n, e2, e4, em, er);
+        delete [] x;
+        delete [] y;
+        delete [] z;
+    }
+    return fails;
+}
+
+/* out[kz][ky][kx] = sum in[z][y][x] * exp(-+2*pi*i*(kz*z/nz + ky*y/ny + kx*x/nx)), natural order */
+static void test_dft3(cmplxT<double> *out, const cmplxT<double> *in, int32_t nz, int32_t ny, int32_t nx, int32_t isInverse)
+{
+    const long double sgn = isInverse ? 1.0L : -1.0L;
+    const int32_t n = nz * ny * nx;
+    int32_t k, j;
+    for (k = 0; k < n; k ++)
+    {
+        const int32_t kz = k / (ny * nx), ky = k / nx % ny, kx = k % nx;
+        long double re = 0, im = 0;
+        for (j = 0; j < n; j ++)
+        {
+            const int32_t z = j / (ny * nx), y = j / nx % ny, x = j % nx;
+            const long double f = (long double)(kz * z % nz) / nz + (long double)(ky * y % ny) / ny + (long double)(kx * x % nx) / nx;
+            const long double a = sgn * 2.0L * (long double) M_PI * f;
+            re += in[j].re * cosl(a) - in[j].im * sinl(a);
+            im += in[j].re * sinl(a) + in[j].im * cosl(a);
+        }
+        out[k].re = (double) re;
+        out[k].im = (double) im;
+    }
+}
+
+/* where bin k of an n-point axis is stored */
+static int32_t test_permute(int32_t n, int32_t k)
+{
+    return n > 2 ? WDLFFT<double>::WDL_fft_permute(n, k) : k;
+}
+
+/* 2D / 3D complex and real transforms against a direct DFT; vector lanes against the scalar columns */
+static int32_t test_nd()
+{
+    static const int32_t cdims[][3] = { { 1, 8, 16 }, { 4, 8, 16 }, { 2, 16, 2 }, { 8, 4, 1 } };
+    static const int32_t rdims[][3] = { { 1, 8, 16 }, { 4, 8, 16 }, { 2, 4, 4 } };
+    int32_t fails = 0, c, i, kz, ky, kx;
+    uint32_t seed = 28;
+    WDLFFT<double>::WDL_fft_init();
+    WDLFFT_ND<double> nd;
+    WDLFFT_ND<double, test_double4> vnd;
+
+    for (c = 0; c < (int32_t)(sizeof(cdims) / sizeof(cdims[0])); c ++)
+    {
+        const int32_t nz = cdims[c][0], ny = cdims[c][1], nx = cdims[c][2], n = nz * ny * nx;
+        cmplxT<double> *x = new cmplxT<double>[n], *y = new cmplxT<double>[n], *v = new cmplxT<double>[n];
+        cmplxT<double> *r = new cmplxT<double>[n], *p = new cmplxT<double>[n];
+        for (i = 0; i < n; i ++)
+        {
+            x[i].re = test_rand(&seed);
+            x[i].im = test_rand(&seed);
+        }
+
+        // forward: X[kz][ky][kx] at [permute(kz)][permute(ky)][permute(kx)]
+        memcpy(y, x, n * sizeof(cmplxT<double>));
+        memcpy(v, x, n * sizeof(cmplxT<double>));
+        EXPECT((nz == 1 ? nd.fft2d(y, ny, nx, 0) : nd.fft3d(y, nz, ny, nx, 0)) == 0, "%dx%dx%d forward failed", nz, ny, nx);
+        EXPECT(vnd.fft3d(v, nz, ny, nx, 0) == 0, "%dx%dx%d lanes forward failed", nz, ny, nx);
+        test_dft3(r, x, nz, ny, nx, 0);
+        for (kz = 0; kz < nz; kz ++)
+            for (ky = 0; ky < ny; ky ++)
+                for (kx = 0; kx < nx; kx ++)
+                    p[(kz * ny + ky) * nx + kx] = y[(test_permute(nz, kz) * ny + test_permute(ny, ky)) * nx + test_permute(nx, kx)];
+        double e = test_err(p, r, n);
+        EXPECT(e < 1e-13, "%dx%dx%d forward: error %g", nz, ny, nx, e);
+        e = test_err(v, y, n);
+        EXPECT(e < 1e-15, "%dx%dx%d forward: lanes differ from scalar columns by %g", nz, ny, nx, e);
+
+        // inverse: that layout in, natural order out
+        memcpy(y, p, n * sizeof(cmplxT<double>));
+        for (kz = 0; kz < nz; kz ++)
+            for (ky = 0; ky < ny; ky ++)
+                for (kx = 0; kx < nx; kx ++)
+                    y[(test_permute(nz, kz) * ny + test_permute(ny, ky)) * nx + test_permute(nx, kx)] = x[(kz * ny + ky) * nx + kx];
+        memcpy(v, y, n * sizeof(cmplxT<double>));
+        EXPECT(nd.fft3d(y, nz, ny, nx, 1) == 0 && vnd.fft3d(v, nz, ny, nx, 1) == 0, "%dx%dx%d inverse failed", nz, ny, nx);
+        test_dft3(r, x, nz, ny, nx, 1);
+        e = test_err(y, r, n);
+        EXPECT(e < 1e-13, "%dx%dx%d inverse: error %g", nz, ny, nx, e);
+        e = test_err(v, y, n);
+        EXPECT(e < 1e-15, "%dx%dx%d inverse: lanes differ from scalar columns by %g", nz, ny, nx, e);
+
+        delete [] x;
+        delete [] y;
+        delete [] v;
+        delete [] r;
+        delete [] p;
+    }
+
+    for (c = 0; c < (int32_t)(sizeof(rdims) / sizeof(rdims[0])); c ++)
+    {
+        const int32_t nz = rdims[c][0], ny = rdims[c][1], nx = rdims[c][2], n = nz * ny * nx, h = nx / 2;
+        double *x = new double[n], *y = new double[n], *v = new double[n];
+        cmplxT<double> *cx = new cmplxT<double>[n], *r = new cmplxT<double>[n];
+        for (i = 0; i < n; i ++)
+        {
+            cx[i].re = y[i] = v[i] = x[i] = test_rand(&seed);
+            cx[i].im = 0;
+        }
+
+        // forward: 2*X for 0 < kx < nx/2; column 0 holds 2*(X[..][0] + i*X[..][nx/2])
+        EXPECT((nz == 1 ? nd.real_fft2d(y, ny, nx, 0) : nd.real_fft3d(y, nz, ny, nx, 0)) == 0, "real %dx%dx%d forward failed", nz, ny, nx);
+        EXPECT(vnd.real_fft3d(v, nz, ny, nx, 0) == 0, "real %dx%dx%d lanes forward failed", nz, ny, nx);
+        test_dft3(r, cx, nz, ny, nx, 0);
+        double e = 0, m = 0;
+        for (kz = 0; kz < nz; kz ++)
+            for (ky = 0; ky < ny; ky ++)
+                for (kx = 0; kx < h; kx ++)
+                {
+                    const cmplxT<double> &o = ((const cmplxT<double> *) y)[(test_permute(nz, kz) * ny + test_permute(ny, ky)) * h + test_permute(h, kx)];
+                    const cmplxT<double> &a = r[(kz * ny + ky) * nx + kx], &b = r[(kz * ny + ky) * nx + h];
+                    const double wr = kx ? 2 * a.re : 2 * (a.re - b.im), wi = kx ? 2 * a.im : 2 * (a.im + b.re);
+                    e = fmax(e, hypot(o.re - wr, o.im - wi));
+                    m = fmax(m, hypot(wr, wi));
+                }
+        EXPECT(e < 1e-13 * m, "real %dx%dx%d forward: error %g", nz, ny, nx, e / m);
+        for (i = 0, e = 0; i < n; i ++) e = fmax(e, fabs(v[i] - y[i]));
+        EXPECT(e < 1e-15 * m, "real %dx%dx%d forward: lanes differ from scalar columns by %g", nz, ny, nx, e / m);
+
+        // inverse of the forward: 2 * n * x
+        EXPECT((nz == 1 ? nd.real_fft2d(y, ny, nx, 1) : nd.real_fft3d(y, nz, ny, nx, 1)) == 0 && vnd.real_fft3d(v, nz, ny, nx, 1) == 0,
+               "real %dx%dx%d inverse failed", nz, ny, nx);
+        for (i = 0, e = 0; i < n; i ++) e = fmax(e, fmax(fabs(y[i] - 2.0 * n * x[i]), fabs(v[i] - y[i])));
+        EXPECT(e < 1e-12 * n, "real %dx%dx%d roundtrip: error %g", nz, ny, nx, e);
+
+        delete [] x;
+        delete [] y;
+        delete [] v;
+        delete [] cx;
+        delete [] r;
+    }
+
+    // unsupported lengths: -1, buffer untouched
+    cmplxT<double> z[64];
+    for (i = 0; i < 64; i ++) z[i].re = z[i].im = i;
+    EXPECT(nd.fft2d(z, 3, 16, 0) == -1 && nd.fft3d(z, 2, 2, 0, 0) == -1 && nd.fft3d(z, 1, 65536, 1, 1) == -1,
+           "bad complex length accepted");
+    EXPECT(nd.real_fft2d((double *) z, 4, 2, 0) == -1 && vnd.real_fft3d((double *) z, 2, 3, 8, 0) == -1, "bad real length accepted");
+    for (i = 0; i < 64; i ++) EXPECT(z[i].re == i && z[i].im == i, "buffer touched at %d", i);
+    return fails;
+}
+
+/* interleave/deinterleave round trips and multichannel transforms against one channel at a time */
+template <typename V, typename S>
+static int32_t test_lanes_one(const char *name)
+{
+    typedef WDLFFT_Lanes<V, S> lanes;
+    const int32_t L = lanes::L, len = 4 * L + 3, flen = 256, nch = 2 * L + 3;
+    int32_t fails = 0, nc, c, i;
+    uint32_t seed = 29;
+    S *data[2 * 16 + 3], *ref[2 * 16 + 3];
+    V *vbuf = new V[2 * flen];
+    WDLFFT<V>::WDL_fft_init();
+    WDLFFT<S>::WDL_fft_init();
+
+    for (c = 0; c < nch; c ++)
+    {
+        data[c] = new S[2 * flen];
+        ref[c] = new S[2 * flen];
+    }
+
+    // every channel count up to L, len not a multiple of L: lane c holds channel c, the rest are 0
+    for (nc = 1; nc <= L; nc ++)
+    {
+        for (c = 0; c < L; c ++)
+            for (i = 0; i < len; i ++) data[c][i] = (S) test_rand(&seed);
+        lanes::interleave(vbuf, data, nc, len);
+        for (i = 0; i < len; i ++)
+            for (c = 0; c < L; c ++)
+                EXPECT(vbuf[i][c] == (c < nc ? data[c][i] : 0), "%s nch %d: lane %d at %d", name, nc, c, i);
+
+        // channels past nc are never written
+        for (c = 0; c < L; c ++)
+            for (i = 0; i < len; i ++) ref[c][i] = -2;
+        lanes::deinterleave(ref, vbuf, nc, len);
+        for (c = 0; c < L; c ++)
+            for (i = 0; i < len; i ++)
+                EXPECT(ref[c][i] == (c < nc ? data[c][i] : -2), "%s nch %d: channel %d at %d", name, nc, c, i);
+    }
+
+    // real: each channel as WDLFFT<S>::real_fft leaves it, with a caller work buffer and from the arena
+    int32_t inv, arena;
+    for (inv = 0; inv < 2; inv ++)
+        for (arena = 0; arena < 2; arena ++)
+        {
+            double e = 0;
+            for (c = 0; c < nch; c ++)
+                for (i = 0; i < flen; i ++) ref[c][i] = data[c][i] = (S) test_rand(&seed);
+            if (arena) lanes::real_fft_multichannel(data, nch, flen, inv);
+            else lanes::real_fft_multichannel(data, nch, flen, inv, vbuf);
+            for (c = 0; c < nch; c ++)
+            {
+                WDLFFT<S>::real_fft(ref[c], flen, inv);
+                for (i = 0; i < flen; i ++) e = fmax(e, fabs((double) data[c][i] - ref[c][i]));
+            }
+            EXPECT(e < 1e-4, "%s real_fft_multichannel inv %d arena %d: error %g", name, inv, arena, e);
+        }
+
+    // complex, same
+    for (inv = 0; inv < 2; inv ++)
+        for (arena = 0; arena < 2; arena ++)
+        {
+            double e = 0;
+            for (c = 0; c < nch; c ++)
+                for (i = 0; i < 2 * flen; i ++) ref[c][i] = data[c][i] = (S) test_rand(&seed);
+            if (arena) lanes::fft_multichannel((cmplxT<S> * const *) data, nch, flen, inv);
+            else lanes::fft_multichannel((cmplxT<S> * const *) data, nch, flen, inv, (cmplxT<V> *) vbuf);
+            for (c = 0; c < nch; c ++)
+            {
+                WDLFFT<S>::fft((cmplxT<S> *) ref[c], flen, inv);
+                for (i = 0; i < 2 * flen; i ++) e = fmax(e, fabs((double) data[c][i] - ref[c][i]));
+            }
+            EXPECT(e < 1e-4, "%s fft_multichannel inv %d arena %d: error %g", name, inv, arena, e);
+        }
+
+    for (c = 0; c < nch; c ++)
+    {
+        delete [] data[c];
+        delete [] ref[c];
+    }
+    delete [] vbuf;
+    return fails;
+}
+
+static int32_t test_lanes()
+{
+    return test_lanes_one<test_float4, float>("float4") +
+           test_lanes_one<test_float8, float>("float8") +
+           test_lanes_one<test_float16, float>("float16") +
+           test_lanes_one<test_double4, double>("double4");
+}
+
+/* fft<N> and real_fft<N> against the runtime transforms, N = 2..32768 */
+#if __cplusplus >= 201703L
+template <int32_t N>
+static int32_t test_fft_n_one(uint32_t *seed)
+{
+    int32_t fails = 0, inv, i;
+    cmplxT<double> *x = new cmplxT<double>[N], *y = new cmplxT<double>[N];
+    for (inv = 0; inv < 2; inv ++)
+    {
+        for (i = 0; i < N; i ++)
+        {
+            y[i].re = x[i].re = test_rand(seed);
+            y[i].im = x[i].im = test_rand(seed);
+        }
+        WDLFFT<double>::fft(x, N, inv);
+        WDLFFT<double>::fft<N>(y, inv);
+        double e = test_err(y, x, N);
+        EXPECT(e < 1e-14, "fft<%d> inv %d: error %g", N, inv, e);
+
+        for (i = 0; i < N / 2; i ++)
+        {
+            y[i].re = x[i].re = test_rand(seed);
+            y[i].im = x[i].im = test_rand(seed);
+        }
+        WDLFFT<double>::real_fft((double *) x, N, inv);
+        WDLFFT<double>::real_fft<N>((double *) y, inv);
+        e = test_err(y, x, N / 2);
+        EXPECT(e < 1e-14, "real_fft<%d> inv %d: error %g", N, inv, e);
+    }
+    delete [] x;
+    delete [] y;
+    if constexpr (N < (1 << FFT_MAXBITLEN)) fails += test_fft_n_one<N * 2>(seed);
+    return fails;
+}
+
+static int32_t test_fft_n()
+{
+    uint32_t seed = 31;
+    WDLFFT<double>::WDL_fft_init();
+    return test_fft_n_one<2>(&seed);
+}
+#endif
+
+/* scratch is aligned, nests, is reused after release, grows past a block, reports failure */
+static int32_t test_arena()
+{
+    int32_t fails = 0, i;
+    WDLFFT_Arena a;
+    const WDLFFT_Arena::mark_t m0 = a.mark();
+
+    char *p = (char *) a.alloc(100), *q = (char *) a.alloc(1);
+    EXPECT(p && q && !((uintptr_t) p % WDL_FFT_ALIGN) && !((uintptr_t) q % WDL_FFT_ALIGN), "misaligned");
+    EXPECT(q >= p + 100, "overlapping allocations");
+    memset(p, 1, 100);
+
+    // bigger than the first block: a new block, the old contents stay
+    char *r = (char *) a.alloc(1 << 20);
+    EXPECT(r && !((uintptr_t) r % WDL_FFT_ALIGN), "large alloc");
+    memset(r, 2, 1 << 20);
+    for (i = 0; i < 100; i ++) EXPECT(p[i] == 1, "block clobbered at %d", i);
+
+    a.release(m0);
+    EXPECT(a.alloc(100) == p, "released scratch not reused");
+
+    // reserve() leaves the arena empty, the next alloc of that size needs no new block
+    WDLFFT_Arena b;
+    b.reserve(1 << 18);
+    const WDLFFT_Arena::mark_t m1 = b.mark();
+    void *s = b.alloc(1 << 18);
+    EXPECT(s != 0, "alloc after reserve");
+    b.release(m1);
+    EXPECT(b.alloc(1 << 18) == s, "reserved block not reused");
+
+    {
+        WDLFFT_Scratch sc;
+        float *f = sc.get<float>(1000);
+        EXPECT(f && !((uintptr_t) f % WDL_FFT_ALIGN), "scratch get");
+    }
+
+    // a request no heap can serve reports through WDL_FFT_ALLOC_FAIL
+    const int32_t before = g_alloc_fails;
+    WDLFFT_Arena c;
+    EXPECT(c.alloc((size_t) 1 << 62) == 0, "impossible alloc succeeded");
+    EXPECT(g_alloc_fails == before + 1, "failure not reported");
+    g_alloc_fails = before;
+    return fails;
+}
+
+/* every kernel gives the runtime transform's result and status */
+static int32_t test_planner()
+{
+    static const int32_t lens[] = { 2, 16, 1024, 32768 };
+    int32_t fails = 0, i, j, k, inv, real;
+    uint32_t seed = 34;
+    WDLFFT<double>::WDL_fft_init();
+    WDLFFT_Planner<double> pl;
+
+    for (i = 0; i < (int32_t)(sizeof(lens) / sizeof(lens[0])); i ++)
+    {
+        const int32_t n = lens[i];
+        cmplxT<double> *x = WDLFFT<double>::alloc_buffer(n), *y = WDLFFT<double>::alloc_buffer(n);
+        for (real = 0; real < 2; real ++)
+            for (inv = 0; inv < 2; inv ++)
+                for (k = 0; k < WDLFFT_Planner<double>::KERNEL_COUNT; k ++)
+                {
+                    // real_fft of len n uses n doubles, the complex one n pairs
+                    if (!pl.set_kernel(n, inv, real != 0, k)) continue;
+                    for (j = 0; j < n; j ++)
+                    {
+                        x[j].re = y[j].re = test_rand(&seed);
+                        x[j].im = y[j].im = test_rand(&seed);
+                    }
+                    const int32_t r0 = real ? WDLFFT<double>::real_fft((double *) x, n, inv) : WDLFFT<double>::fft(x, n, inv);
+                    const int32_t r1 = real ? pl.real_fft((double *) y, n, inv) : pl.fft(y, n, inv);
+                    EXPECT(r0 == 0 && r1 == 0, "len %d kernel %s: status %d %d", n, pl.kernel_name(k), r0, r1);
+                    // fixed<N> uses constexpr twiddles, so the last bit may differ from the runtime tables
+                    const double e = test_err(y, x, real ? n / 2 : n);
+                    EXPECT(e < 1e-13, "len %d %s%s kernel %s: error %g", n, real ? "real " : "",
+                           inv ? "inverse" : "forward", pl.kernel_name(k), e);
+                }
+        WDLFFT<double>::free_buffer(x);
+        WDLFFT<double>::free_buffer(y);
+    }
+
+    EXPECT(pl.plan(1024, 0, false, 1.0) >= 0, "plan(1024)");
+    EXPECT(pl.plan(1000, 0) == -1, "plan(1000) accepted");
+
+    // lengths no kernel runs: -1 and the buffer untouched, whatever the slot it falls into holds
+    cmplxT<double> z[1000];
+    for (k = 0; k < WDLFFT_Planner<double>::KERNEL_COUNT; k ++)
+    {
+        pl.set_kernel(512, 0, false, k);
+        pl.set_kernel(512, 0, true, k);
+        for (j = 0; j < 1000; j ++) z[j].re = z[j].im = j;
+        EXPECT(pl.fft(z, 1000, 0) == -1, "fft(1000) kernel %s", pl.kernel_name(k));
+        EXPECT(pl.real_fft((double *) z, 1000, 0) == -1, "real_fft(1000) kernel %s", pl.kernel_name(k));
+        EXPECT(pl.fft(z, 0, 0) == -1 && pl.fft(z, 65536, 0) == -1, "fft(0/65536) kernel %s", pl.kernel_name(k));
+        for (j = 0; j < 1000; j ++) EXPECT(z[j].re == j && z[j].im == j, "buffer touched at %d", j);
+    }
+    return fails;
+}
+
+#ifdef WDL_FFT_STATS
+/* each stage counts its own calls and bytes in its size bucket; reset clears everything */
+static int32_t test_stats()
+{
+    int32_t fails = 0, st, b, i;
+    uint32_t seed = 35;
+    cmplxT<double> x[1024], y[128];
+    WDLFFT_StatsSnapshot s;
+    WDLFFT<double> f;
+    WDLFFT<double>::WDL_fft_init();
+    for (i = 0; i < 1024; i ++) x[i].re = x[i].im = test_rand(&seed);
+    for (i = 0; i < 128; i ++) y[i] = x[i];
+
+    WDLFFT_Stats::global().reset();
+    WDLFFT<double>::fft(x, 1024, 0);                    // fft 1024
+    WDLFFT<double>::real_fft((double *) x, 1024, 0);    // real_fft 1024 = fft 512 + real_split 1024
+    WDLFFT<double>::fft<256>(x, 1);                     // fft 256
+    f.WDL_fft_complexmul(x, y, 100);                    // complexmul, bucket 64
+    WDLFFT_Stats::global().snapshot(&s);
+
+    static const struct { int32_t stage, bits; uint64_t calls, bytes; } want[] = {
+        { WDL_FFT_STAGE_FFT, 10, 1, 1024 * sizeof(cmplxT<double>) },
+        { WDL_FFT_STAGE_FFT, 9, 1, 512 * sizeof(cmplxT<double>) },
+        { WDL_FFT_STAGE_FFT, 8, 1, 256 * sizeof(cmplxT<double>) },
+        { WDL_FFT_STAGE_REAL_FFT, 10, 1, 1024 * sizeof(double) },
+        { WDL_FFT_STAGE_REAL_SPLIT, 10, 1, 1024 * sizeof(double) },
+        { WDL_FFT_STAGE_COMPLEXMUL, 6, 1, 200 * sizeof(cmplxT<double>) },
+    };
+    for (st = 0; st < WDL_FFT_STAGES; st ++)
+        for (b = 0; b <= FFT_MAXBITLEN; b ++)
+        {
+            const WDLFFT_StatsSnapshot::entry &e = s.e[st][b];
+            uint64_t calls = 0, bytes = 0;
+            for (i = 0; i < (int32_t)(sizeof(want) / sizeof(want[0])); i ++)
+                if (want[i].stage == st && want[i].bits == b)
+                {
+                    calls = want[i].calls;
+                    bytes = want[i].bytes;
+                }
+            EXPECT(e.calls == calls && e.bytes == bytes, "%s %d: %llu calls %llu bytes, want %llu %llu",
+                   WDLFFT_StatsSnapshot::stage_name(st), 1 << b, (unsigned long long) e.calls, (unsigned long long) e.bytes,
+                   (unsigned long long) calls, (unsigned long long) bytes);
+            EXPECT(e.max_ticks <= e.ticks && (e.calls || !e.ticks), "%s %d: ticks %llu max %llu",
+                   WDLFFT_StatsSnapshot::stage_name(st), 1 << b, (unsigned long long) e.ticks, (unsigned long long) e.max_ticks);
+        }
+
+    // a second call adds to the same bucket
+    WDLFFT<double>::fft(x, 1024, 0);
+    WDLFFT_Stats::global().snapshot(&s);
+    EXPECT(s.e[WDL_FFT_STAGE_FFT][10].calls == 2 && s.e[WDL_FFT_STAGE_FFT][10].bytes == 2048 * sizeof(cmplxT<double>), "fft 1024 did not advance");
+
+    WDLFFT_Stats::global().reset();
+    WDLFFT_Stats::global().snapshot(&s);
+    for (st = 0; st < WDL_FFT_STAGES; st ++)
+        for (b = 0; b <= FFT_MAXBITLEN; b ++)
+        {
+            const WDLFFT_StatsSnapshot::entry &e = s.e[st][b];
+            EXPECT(!e.calls && !e.ticks && !e.max_ticks && !e.bytes, "%s %d not reset", WDLFFT_StatsSnapshot::stage_name(st), 1 << b);
+        }
+    return fails;
+}
+#endif
+
+/* the guard sets FTZ only inside its scope and puts the register back as it found it */
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define TEST_FTZ_BITS 0x8040u
+static uint64_t test_fpmode() { return _mm_getcsr(); }
+static void test_set_fpmode(uint64_t v) { _mm_setcsr((unsigned int) v); }
+#elif defined(__aarch64__)
+#define TEST_FTZ_BITS (1u << 24)
+static uint64_t test_fpmode() { uint64_t v; __asm__ __volatile__("mrs %0, fpcr" : "=r"(v)); return v; }
+static void test_set_fpmode(uint64_t v) { __asm__ __volatile__("msr fpcr, %0" : : "r"(v)); }
+#endif
+
+template <typename T>
+static int32_t test_flush_one(const char *name)
+{
+    typedef typename WDLFFT<T>::scalar_t S;
+    const S mn = std::numeric_limits<S>::min(), dn = std::numeric_limits<S>::denorm_min();
+    const S in[] = { dn, -dn, mn / 2, -mn / 2, mn, -mn, 1, -1, 0, 2 * mn, (S) 1e-20, (S) -1e-30 };
+    const int32_t cnt = (int32_t)(sizeof(in) / sizeof(in[0])), lanes = (int32_t)(sizeof(T) / sizeof(S));
+    const int32_t n = cnt / 2;
+    int32_t fails = 0, i, l;
+    cmplxT<T> buf[sizeof(in) / sizeof(in[0]) / 2 + 1];
+    S *p = (S *) buf;
+
+    // default threshold: subnormals go, the smallest normal and everything above stay
+    for (i = 0; i < cnt; i ++)
+        for (l = 0; l < lanes; l ++) p[i * lanes + l] = in[i];
+    for (l = 0; l < 2 * lanes; l ++) p[cnt * lanes + l] = dn;
+    WDLFFT<T>::flush_denormals(buf, n);
+    for (i = 0; i < cnt; i ++)
+        for (l = 0; l < lanes; l ++)
+        {
+            const S want = (in[i] < mn && in[i] > -mn) ? 0 : in[i];
+            EXPECT(p[i * lanes + l] == want, "%s: %g -> %g", name, (double) in[i], (double) p[i * lanes + l]);
+        }
+    for (l = 0; l < 2 * lanes; l ++) EXPECT(p[cnt * lanes + l] == dn, "%s: wrote past n", name);
+
+    // explicit threshold: strictly smaller magnitudes go
+    for (i = 0; i < cnt; i ++)
+        for (l = 0; l < lanes; l ++) p[i * lanes + l] = in[i];
+    WDLFFT<T>::flush_denormals(buf, n, (S) 1e-20);
+    for (i = 0; i < cnt; i ++)
+        for (l = 0; l < lanes; l ++)
+        {
+            const S want = (in[i] < (S) 1e-20 && in[i] > (S) -1e-20) ? 0 : in[i];
+            EXPECT(p[i * lanes + l] == want, "%s thresh 1e-20: %g -> %g", name, (double) in[i], (double) p[i * lanes + l]);
+        }
+    return fails;
+}
+
+static int32_t test_denormal()
+{
+    int32_t fails = 0;
+    static_assert(!std::is_copy_constructible<WDLFFT_DenormalGuard>::value && !std::is_copy_assignable<WDLFFT_DenormalGuard>::value,
+                  "WDLFFT_DenormalGuard must not be copyable");
+
+#ifdef TEST_FTZ_BITS
+    const uint64_t orig = test_fpmode(), off = orig & ~(uint64_t) TEST_FTZ_BITS;
+    volatile float tiny = std::numeric_limits<float>::min(), half = 0.5f;
+
+    // bits clear before: set inside, nested guards leave them set, cleared again after
+    test_set_fpmode(off);
+    EXPECT(tiny * half != 0, "denormal result flushed without a guard");
+    uint64_t before = test_fpmode();    // status flags included, the guard puts those back too
+    {
+        WDLFFT_DenormalGuard g;
+        EXPECT((test_fpmode() & TEST_FTZ_BITS) == TEST_FTZ_BITS, "bits not set inside the guard");
+        {
+            WDLFFT_DenormalGuard g2;
+            EXPECT((test_fpmode() & TEST_FTZ_BITS) == TEST_FTZ_BITS, "bits not set inside a nested guard");
+        }
+        EXPECT((test_fpmode() & TEST_FTZ_BITS) == TEST_FTZ_BITS, "nested guard cleared the outer one's bits");
+        EXPECT(tiny * half == 0, "denormal result not flushed inside the guard");
+    }
+    EXPECT(test_fpmode() == before, "register not restored: %llx, was %llx", (unsigned long long) test_fpmode(), (unsigned long long) before);
+
+    // bits already set: left alone
+    test_set_fpmode(off | TEST_FTZ_BITS);
+    before = test_fpmode();
+    {
+        WDLFFT_DenormalGuard g;
+        EXPECT((test_fpmode() & TEST_FTZ_BITS) == TEST_FTZ_BITS, "bits lost inside the guard");
+    }
+    EXPECT(test_fpmode() == before, "preset bits not kept");
+    test_set_fpmode(orig);
+#endif
+
+    fails += test_flush_one<float>("float");
+    fails += test_flush_one<double>("double");
+    fails += test_flush_one<test_float4>("float4");
+    fails += test_flush_one<test_double2>("double2");
+    return fails;
+}
+
+/* FNV-1a over the output words, for the pinned results below */
+template <typename Q>
+static uint32_t test_fixed_hash(const cmplxT<Q> *buf, int32_t n)
+{
+    uint32_t h = 2166136261u;
+    int32_t i;
+    for (i = 0; i < 2 * n; i ++)
+    {
+        uint32_t v = (uint32_t)(int32_t)(((const Q *) buf)[i]);
+        int32_t b;
+        for (b = 0; b < 4; b ++, v >>= 8) h = (h ^ (v & 0xff)) * 16777619u;
+    }
+    return h;
+}
+
+/* one Q format: accuracy with error growing like sqrt(len), bin positions, scale_stages, saturation, status, pinned output */
+template <typename Q>
+static int32_t test_fixed_one(const char *name, double tol, uint32_t golden)
+{
+    typedef WDLFFT_Fixed<Q> fx;
+    const double one = ldexp(1.0, fx::FRAC);
+    const Q qmax = (Q)(one - 1), qmin = (Q)(-one);
+    int32_t fails = 0, n, j, inv;
+    uint32_t seed = 38;
+
+    cmplxT<Q> *q = new cmplxT<Q>[32768], *s = new cmplxT<Q>[32768];
+    cmplxT<double> *x = new cmplxT<double>[32768], *y = new cmplxT<double>[32768], *r = new cmplxT<double>[32768];
+
+    for (n = 2; n <= 32768; n *= 2)
+    {
+        for (inv = 0; inv < 2; inv ++)
+        {
+            // half scale random input; every stage halves, so out = X/n
+            for (j = 0; j < n; j ++)
+            {
+                q[j].re = (Q) floor(test_rand(&seed) * 0.5 * one);
+                q[j].im = (Q) floor(test_rand(&seed) * 0.5 * one);
+                x[j].re = q[j].re / one;
+                x[j].im = q[j].im / one;
+            }
+            EXPECT(fx::fft(q, n, inv) == 0, "%s fft(%d) failed", name, n);
+            for (j = 0; j < n; j ++)
+            {
+                y[j].re = q[j].re / one * n;
+                y[j].im = q[j].im / one * n;
+            }
+
+            // same layout as WDLFFT<double>::fft: forward out and inverse in are both permuted
+            if (!inv)
+            {
+                memcpy(r, x, n * sizeof(cmplxT<double>));
+                WDLFFT<double>::fft(r, n, 0);
+                double e = test_err(y, r, n);
+                EXPECT(e < tol * sqrt((double) n), "%s len %d forward: error %g against WDLFFT<double>", name, n, e);
+
+                // bin k at WDL_fft_permute(n, k), against the DFT
+                if (n <= 1024)
+                {
+                    test_dft(r, x, n, 0);
+                    for (j = 0; j < n; j ++) x[j] = y[n > 2 ? WDLFFT<double>::WDL_fft_permute(n, j) : j];
+                    e = test_err(x, r, n);
+                    EXPECT(e < tol * sqrt((double) n), "%s len %d forward: error %g against the DFT", name, n, e);
+                }
+            } else if (n <= 1024)
+            {
+                for (j = 0; j < n; j ++) r[j] = x[n > 2 ? WDLFFT<double>::WDL_fft_permute(n, j) : j];
+                test_dft(x, r, n, 1);
+                const double e = test_err(y, x, n);
+                EXPECT(e < tol * sqrt((double) n), "%s len %d inverse: error %g against the DFT", name, n, e);
+            }
+        }
+
+        // forward and inverse together scale every stage once: the input comes back
+        if (n <= 4096)
+        {
+            static const uint32_t masks[] = { ~0u, 0x55555555u, 0xaaaaaaaau };
+            int32_t m;
+            for (m = 0; m < 3; m ++)
+            {
+                const uint32_t sf = masks[m], si = ~masks[m];
+                const double amp = m ? 0.25 / sqrt((double) n) : 0.5;      // unscaled forward stages grow the spectrum
+                for (j = 0; j < n; j ++)
+                {
+                    s[j].re = q[j].re = (Q) floor(test_rand(&seed) * amp * one);
+                    s[j].im = q[j].im = (Q) floor(test_rand(&seed) * amp * one);
+                }
+                fx::fft(q, n, 0, sf);
+                fx::fft(q, n, 1, si);
+                double e = 0;
+                for (j = 0; j < n; j ++)
+                {
+                    e = fmax(e, fabs((double) q[j].re - s[j].re));
+                    e = fmax(e, fabs((double) q[j].im - s[j].im));
+                }
+                EXPECT(e <= 4 * sqrt((double) n) + 2, "%s len %d round trip, forward stages %x: %g lsb off", name, n, sf & (n - 1), e);
+            }
+        }
+
+        // unscaled full scale DC saturates at the rails instead of wrapping
+        for (j = 0; j < n; j ++) q[j].re = q[j].im = qmax;
+        fx::fft(q, n, 0, 0);
+        bool ok = q[0].re == qmax && q[0].im == qmax;
+        for (j = 1; j < n; j ++) ok = ok && !q[j].re && !q[j].im;
+        for (j = 0; j < n; j ++) q[j].re = q[j].im = qmin;
+        fx::fft(q, n, 0, 0);
+        ok = ok && q[0].re == qmin && q[0].im == qmin;
+        for (j = 1; j < n; j ++) ok = ok && !q[j].re && !q[j].im;
+        EXPECT(ok, "%s len %d: full scale DC did not saturate cleanly", name, n);
+    }
+
+    // bad lengths: -1, buffer untouched
+    for (j = 0; j < 1000; j ++) q[j].re = q[j].im = (Q) j;
+    EXPECT(fx::fft(q, 0, 0) == -1 && fx::fft(q, 1, 0) == -1 && fx::fft(q, 1000, 0) == -1 && fx::fft(q, 65536, 1) == -1,
+           "%s bad length accepted", name);
+    for (j = 0; j < 1000; j ++) EXPECT(q[j].re == (Q) j && q[j].im == (Q) j, "%s buffer touched at %d", name, j);
+
+    // the arithmetic is integer and fully specified, so the output is pinned to the bit
+    seed = 1;
+    for (j = 0; j < 256; j ++)
+    {
+        q[j].re = (Q) floor(test_rand(&seed) * 0.9 * one);
+        q[j].im = (Q) floor(test_rand(&seed) * 0.9 * one);
+    }
+    fx::fft(q, 256, 0);
+    fx::fft(q, 256, 1, 0x0f);
+    const uint32_t h = test_fixed_hash(q, 256);
+    EXPECT(h == golden, "%s: output hash %08x, expected %08x", name, h, golden);
+
+    delete [] q;
+    delete [] s;
+    delete [] x;
+    delete [] y;
+    delete [] r;
+    return fails;
+}
+
+/* Q15 and Q31 against WDLFFT<double> and the DFT, and their exact output */
+static int32_t test_fixed()
+{
+    WDLFFT<double>::WDL_fft_init();
+    return test_fixed_one<int16_t>("q15", 2e-4, 0x0abad083u) + test_fixed_one<int32_t>("q31", 4e-9, 0x482574c9u);
+}
+
+/* real_fft2 leaves x and y as two real_fft calls would, forward and inverse, every length */
+static int32_t test_real_fft2()
+{
+    const int32_t maxlen = 1 << FFT_MAXBITLEN;
+    int32_t fails = 0, len, inv, arena, i;
+    uint32_t seed = 41;
+    double *x = new double[maxlen], *y = new double[maxlen], *rx = new double[maxlen], *ry = new double[maxlen];
+    cmplxT<double> *work = new cmplxT<double>[maxlen];
+    WDLFFT<double>::WDL_fft_init();
+
+    for (len = 2; len <= maxlen; len *= 2)
+        for (inv = 0; inv < 2; inv ++)
+            for (arena = 0; arena < 2; arena ++)
+            {
+                // inverse input is any packed spectrum, so random data serves both directions
+                for (i = 0; i < len; i ++)
+                {
+                    rx[i] = x[i] = test_rand(&seed);
+                    ry[i] = y[i] = test_rand(&seed);
+                }
+                const int32_t r = arena ? WDLFFT<double>::real_fft2(x, y, len, inv) : WDLFFT<double>::real_fft2(x, y, len, inv, work);
+                EXPECT(r == 0, "len %d inv %d arena %d: status %d", len, inv, arena, r);
+                WDLFFT<double>::real_fft(rx, len, inv);
+                WDLFFT<double>::real_fft(ry, len, inv);
+
+                double e = 0, m = 0;
+                for (i = 0; i < len; i ++)
+                {
+                    e = fmax(e, fmax(fabs(x[i] - rx[i]), fabs(y[i] - ry[i])));
+                    m = fmax(m, fmax(fabs(rx[i]), fabs(ry[i])));
+                }
+                EXPECT(e <= 1e-14 * m * (log2(len) + 1), "len %d inv %d arena %d: error %g", len, inv, arena, e / m);
+            }
+
+    // unsupported lengths: -1, buffers untouched
+    for (i = 0; i < 8; i ++) x[i] = y[i] = i;
+    EXPECT(WDLFFT<double>::real_fft2(x, y, 6, 0, work) == -1 && WDLFFT<double>::real_fft2(x, y, 0, 0) == -1 &&
+           WDLFFT<double>::real_fft2(x, y, 2 * maxlen, 1) == -1, "bad length accepted");
+    for (i = 0; i < 8; i ++) EXPECT(x[i] == i && y[i] == i, "buffer touched at %d", i);
+
+    delete [] x;
+    delete [] y;
+    delete [] rx;
+    delete [] ry;
+    delete [] work;
+    return fails;
+}
+
+/* channel outputs against the defining sum, input fed in uneven chunks */
+static int32_t test_pfb()
+{
+    const int32_t m = 16, p = 4, total = 1000;
+    int32_t fails = 0, os, i, t, k, j;
+    uint32_t seed = 42;
+    WDLFFT<double>::WDL_fft_init();
+
+    static_assert(!std::is_copy_constructible< WDLFFT_PFB<double> >::value, "filterbank must not be copied");
+    static_assert(!std::is_copy_assignable< WDLFFT_PFB<double> >::value, "filterbank must not be copied");
+
+    cmplxT<double> *x = new cmplxT<double>[total], *y = new cmplxT<double>[(total / (m / 2) + 8) * m];
+    double h[m * p];
+    WDLFFT_PFB<double>::design_prototype(h, m, p);
+    for (i = 0; i < total; i ++)
+    {
+        x[i].re = test_rand(&seed);
+        x[i].im = test_rand(&seed);
+    }
+
+    for (os = 1; os <= 2; os ++)
+    {
+        WDLFFT_PFB<double> pfb;
+        EXPECT(pfb.init(m, p, os), "init");
+        const int32_t d = pfb.hop();
+        int32_t nb = 0, pos = 0, c = 1;
+        while (pos < total)
+        {
+            const int32_t n = c < total - pos ? c : total - pos;
+            nb += pfb.process(x + pos, n, y + nb * m);
+            pos += n;
+            c = c * 3 % 37 + 1;
+        }
+        EXPECT(nb == total / d, "oversample %d: %d blocks, expected %d", os, nb, total / d);
+
+        double e = 0;
+        for (t = 0; t < nb; t ++)
+            for (k = 0; k < m; k ++)
+            {
+                const int32_t s = (t + 1) * d - p * m;
+                long double re = 0, im = 0;
+                for (j = 0; j < p * m; j ++)
+                {
+                    if (s + j < 0) continue;
+                    const long double a = -2.0L * (long double) M_PI * k * ((s + j) & (m - 1)) / m;
+                    re += h[j] * (x[s + j].re * cosl(a) - x[s + j].im * sinl(a));
+                    im += h[j] * (x[s + j].re * sinl(a) + x[s + j].im * cosl(a));
+                }
+                const cmplxT<double> &o = y[t * m + pfb.channel_index(k)];
+                e = fmax(e, hypot(o.re - (double) re, o.im - (double) im));
+            }
+        EXPECT(e < 1e-12, "oversample %d: error %g", os, e);
+
+        // four streams in the lanes of one vector filterbank, against the scalar one
+        const int32_t L = 4;
+        WDLFFT_PFB<test_double4> vp;
+        EXPECT(vp.init(m, p, os), "init lanes");
+        cmplxT<test_double4> *xv = new cmplxT<test_double4>[total], *yv = new cmplxT<test_double4>[(total / (m / 2) + 8) * m];
+        for (i = 0; i < total; i ++)
+            for (j = 0; j < L; j ++)
+            {
+                xv[i].re[j] = j ? test_rand(&seed) : x[i].re;
+                xv[i].im[j] = j ? test_rand(&seed) : x[i].im;
+            }
+        const int32_t nv = vp.process(xv, total, yv);
+        EXPECT(nv == nb, "oversample %d: %d lane blocks, expected %d", os, nv, nb);
+        for (j = 0; j < L; j ++)
+        {
+            WDLFFT_PFB<double> sp;
+            cmplxT<double> *xs = new cmplxT<double>[total];
+            sp.init(m, p, os);
+            for (i = 0; i < total; i ++)
+            {
+                xs[i].re = xv[i].re[j];
+                xs[i].im = xv[i].im[j];
+            }
+            const int32_t ns = sp.process(xs, total, y);
+            e = 0;
+            for (i = 0; i < ns * m && ns == nv; i ++) e = fmax(e, hypot(yv[i].re[j] - y[i].re, yv[i].im[j] - y[i].im));
+            EXPECT(ns == nv && e < 1e-12, "oversample %d lane %d: %d blocks, error %g", os, j, ns, e);
+            delete [] xs;
+        }
+        delete [] xv;
+        delete [] yv;
+    }
+    delete [] x;
+    delete [] y;
+    return fails;
+}
+
+/* power of out[0..n-1] at f cycles per sample */
+static double test_tone_power(const double *out, int32_t n, double f)
+{
+    double re = 0, im = 0;
+    int32_t i;
+    for (i = 0; i < n; i ++)
+    {
+        re += out[i] * cos(2.0 * M_PI * f * i);
+        im += out[i] * sin(2.0 * M_PI * f * i);
+    }
+    return (re * re + im * im) / ((double) n * n);
+}
+
+/* leaves freed heap blocks full of NaN, so buffers allocated next start out as garbage */
+static void test_poison_heap()
+{
+    void *p[64];
+    int32_t i;
+    for (i = 0; i < 64; i ++)
+    {
+        const size_t sz = 4096 << (i & 3);
+        p[i] = WDL_fft_aligned_alloc(sz);
+        if (!p[i]) continue;
+        double *d = (double *) p[i];
+        for (size_t k = 0; k < sz / sizeof(double); k ++) d[k] = NAN;
+    }
+    for (i = 0; i < 64; i ++) WDL_fft_aligned_free(p[i]);
+}
+
+/* pitch moves a tone, init() on recycled memory and reset() after NaN input give clean output */
+static int32_t test_pvoc()
+{
+    static const double pitches[] = { 0.7, 1.5 };
+    const int32_t n = 1024, total = 16384;
+    const double f0 = 40.5 / n;          // between bins, so phase propagation matters
+    int32_t fails = 0, i, j;
+    WDLFFT<double>::WDL_fft_init();
+
+    static_assert(!std::is_copy_constructible< WDLFFT_PVoc<double> >::value, "vocoder must not be copied");
+    static_assert(!std::is_copy_assignable< WDLFFT_PVoc<double> >::value, "vocoder must not be copied");
+
+    double *x = new double[total], *a = 0, *b = 0;
+    for (i = 0; i < total; i ++) x[i] = 0.5 * sin(2.0 * M_PI * f0 * i);
+
+    for (j = 0; j < (int32_t)(sizeof(pitches) / sizeof(pitches[0])); j ++)
+    {
+        const double pitch = pitches[j];
+        WDLFFT_PVoc<double> fresh, used;
+        test_poison_heap();
+        EXPECT(fresh.init(n) && used.init(n), "init");
+        a = new double[fresh.max_output(total)];
+        b = new double[used.max_output(total)];
+
+        // run at the other pitch into a NaN burst, which leaves NaN phases behind, then reset
+        used.set_pitch(pitches[1 - j]);
+        used.set_stretch(1.3);
+        used.process(x, total / 4, b);
+        for (i = 0; i < n; i ++) a[i] = i & 1 ? NAN : INFINITY;
+        used.process(a, n, b);
+        used.reset();
+        used.set_stretch(1);
+
+        fresh.set_pitch(pitch);
+        used.set_pitch(pitch);
+        const int32_t na = fresh.process(x, total, a), nb = used.process(x, total, b);
+        EXPECT(na == nb && na > 0, "pitch %g: %d vs %d samples", pitch, na, nb);
+
+        bool finite = true;
+        for (i = 0; i < na; i ++) finite = finite && isfinite(a[i]);
+        EXPECT(finite, "pitch %g: non-finite output", pitch);
+        EXPECT(!memcmp(a, b, na * sizeof(double)), "pitch %g: output after reset() differs from a fresh vocoder", pitch);
+
+        // skip the start-up, the tone is now at pitch * f0
+        const double pm = test_tone_power(a + n, na - n, pitch * f0), p0 = test_tone_power(a + n, na - n, f0);
+        EXPECT(pm > 0.01 && pm > 100 * p0, "pitch %g: power %g at the new frequency, %g at the old", pitch, pm, p0);
+        delete [] a;
+        delete [] b;
+    }
+
+    // two lanes, a tone and noise, against one scalar vocoder each
+    {
+        const int32_t L = 2;
+        uint32_t seed = 43;
+        WDLFFT_PVoc<test_double2> vv;
+        WDLFFT_PVoc<double> sv[L];
+        EXPECT(vv.init(n), "init lanes");
+        vv.set_stretch(1.25);
+        vv.set_pitch(1.5);
+        test_double2 *xv = new test_double2[total], *yv = new test_double2[vv.max_output(total)];
+        double *xs = new double[total];
+        for (i = 0; i < total; i ++)
+        {
+            xv[i][0] = x[i];
+            xv[i][1] = 0.5 * test_rand(&seed);
+        }
+        const int32_t nv = vv.process(xv, total, yv);
+        for (j = 0; j < L; j ++)
+        {
+            EXPECT(sv[j].init(n), "init lane %d", j);
+            sv[j].set_stretch(1.25);
+            sv[j].set_pitch(1.5);
+            for (i = 0; i < total; i ++) xs[i] = xv[i][j];
+            a = new double[sv[j].max_output(total)];
+            const int32_t ns = sv[j].process(xs, total, a);
+            EXPECT(ns == nv, "lane %d: %d samples, scalar %d", j, nv, ns);
+            double e = 0;
+            for (i = 0; i < ns && i < nv; i ++) e = fmax(e, fabs(yv[i][j] - a[i]));
+            EXPECT(e < 1e-9, "lane %d: error %g against the scalar vocoder", j, e);
+            delete [] a;
+        }
+        delete [] xv;
+        delete [] yv;
+        delete [] xs;
+    }
+    delete [] x;
+    return fails;
+}
+
+/* a sine on a bin reads back at its amplitude, framed and streaming; none of the classes copy */
+static int32_t test_cqt()
+{
+    const double fs = 44100, amp = 0.8;
+    int32_t fails = 0, i, k, t;
+    WDLFFT<double>::WDL_fft_init();
+
+    static_assert(!std::is_copy_constructible< WDLFFT_CQKernels<double> >::value, "kernels must not be copied");
+    static_assert(!std::is_copy_constructible< WDLFFT_CQT<double> >::value, "transform must not be copied");
+    static_assert(!std::is_copy_constructible< WDLFFT_CQTOctaves<double> >::value, "transform must not be copied");
+    static_assert(!std::is_copy_assignable< WDLFFT_CQTOctaves<double> >::value, "transform must not be copied");
+
+    WDLFFT_CQT<double> cq;
+    EXPECT(cq.init(fs, 110, 7040, 24), "init");
+    const int32_t n = cq.fft_size(), bins = cq.bins();
+    double *x = new double[n];
+    cmplxT<double> *y = new cmplxT<double>[bins];
+    for (k = 5; k < bins; k += 29)
+    {
+        for (i = 0; i < n; i ++) x[i] = amp * cos(2.0 * M_PI * cq.freq(k) / fs * (i - n / 2));
+        cq.transform(x, y);
+        // cosine phase 0 at the center: cq[k] = amp, real
+        EXPECT(fabs(y[k].re - amp) < 0.01 * amp && fabs(y[k].im) < 0.01 * amp,
+               "bin %d (%g Hz): %g%+gi", k, cq.freq(k), y[k].re, y[k].im);
+        if (k + 4 < bins) EXPECT(hypot(y[k + 4].re, y[k + 4].im) < 0.05 * amp, "bin %d leaks into %d", k, k + 4);
+    }
+    delete [] x;
+    delete [] y;
+
+    // streaming: once the longest kernel is full, every frame sees the same amplitude
+    WDLFFT_CQTOctaves<double> oc;
+    EXPECT(oc.init(fs, 55, 7040, 24, 512), "octaves init");
+    // a frame is centered latency() behind the input and reaches half a kernel ahead of that
+    const int32_t ob = oc.bins(), hop = oc.hop(), total = (2 * oc.latency() / hop + 4) * hop;
+    const int32_t probe[] = { 3, ob / 2, ob - 4 };
+    for (k = 0; k < 3; k ++)
+    {
+        WDLFFT_CQTOctaves<double> s;
+        s.init(fs, 55, 7040, 24, 512);
+        const double f = s.freq(probe[k]);
+        x = new double[total];
+        y = new cmplxT<double>[(total / hop + 1) * ob];
+        for (i = 0; i < total; i ++) x[i] = amp * sin(2.0 * M_PI * f / fs * i);
+        const int32_t frames = s.process(x, total, y);
+        EXPECT(frames == total / hop, "%d frames", frames);
+        for (t = frames - 4; t < frames; t ++)
+        {
+            const double m = hypot(y[t * ob + probe[k]].re, y[t * ob + probe[k]].im);
+            EXPECT(fabs(m - amp) < 0.02 * amp, "octaves bin %d (%g Hz) frame %d: %g", probe[k], f, t, m);
+        }
+        delete [] x;
+        delete [] y;
+    }
+    return fails;
+}
+
+/* get_power() of one Welch configuration against per-frame DFTs, input in uneven pieces */
+template <typename V>
+static int32_t test_welch_one(const char *name, const double *x, int32_t total, int32_t len, int32_t hop)
+{
+    const int32_t half = len / 2, nf = (total - len) / hop + 1;
+    int32_t fails = 0, i, k, f, pos = 0, c = 1, got = 0;
+    double wsum = 0, e = 0, m = 0;
+    double *ref = new double[half + 1], *psd = new double[half + 1];
+    WDLFFT_Welch<double, V> w;
+
+    EXPECT(w.init(len, hop), "%s: init", name);
+    while (pos < total)
+    {
+        const int32_t n = c < total - pos ? c : total - pos;
+        got += w.process(x + pos, n);
+        pos += n;
+        c = c * 5 % 97 + 1;
+    }
+    got += w.flush();
+    EXPECT(got == nf && w.frames() == nf, "%s: %d frames, expected %d", name, got, nf);
+    w.get_power(psd);
+
+    for (i = 0; i < len; i ++) wsum += 0.5 - 0.5 * cos(2.0 * M_PI * i / len);
+    for (k = 0; k <= half; k ++)
+    {
+        double acc = 0;
+        for (f = 0; f < nf; f ++)
+        {
+            double re = 0, im = 0;
+            for (i = 0; i < len; i ++)
+            {
+                const double v = x[f * hop + i] * (0.5 - 0.5 * cos(2.0 * M_PI * i / len));
+                re += v * cos(2.0 * M_PI * ((int64_t) i * k % len) / len);
+                im -= v * sin(2.0 * M_PI * ((int64_t) i * k % len) / len);
+            }
+            acc += re * re + im * im;
+        }
+        ref[k] = acc * (k > 0 && k < half ? 2.0 : 1.0) / ((double) nf * wsum * wsum);
+        e = fmax(e, fabs(psd[k] - ref[k]));
+        m = fmax(m, ref[k]);
+    }
+    EXPECT(e < 1e-12 * m, "%s: error %g of %g", name, e, m);
+    delete [] ref;
+    delete [] psd;
+    return fails;
+}
+
+/* scalar and batched lanes against direct DFTs, a sine reads A^2/2 */
+static int32_t test_welch()
+{
+    const int32_t len = 256, total = 5000;
+    int32_t fails = 0, i;
+    uint32_t seed = 45;
+    WDLFFT<double>::WDL_fft_init();
+
+    static_assert(!std::is_copy_constructible< WDLFFT_Welch<double> >::value, "accumulator must not be copied");
+    static_assert(!std::is_copy_assignable< WDLFFT_Welch<double> >::value, "accumulator must not be copied");
+
+    double *x = new double[total];
+    for (i = 0; i < total; i ++) x[i] = test_rand(&seed);
+    fails += test_welch_one<double>("double", x, total, len, len / 2);
+    fails += test_welch_one<double>("double hop 100", x, total, len, 100);
+    WDLFFT<test_double2>::WDL_fft_init();
+    WDLFFT<test_double4>::WDL_fft_init();
+    fails += test_welch_one<test_double2>("test_double2", x, total, len, len / 2);
+    fails += test_welch_one<test_double4>("test_double4 hop 100", x, total, len, 100);
+
+    // amplitude 0.5 on bin 20: 0.125 there, a quarter of that on each neighbour (Hann)
+    WDLFFT_Welch<double> w;
+    double psd[len / 2 + 1];
+    for (i = 0; i < total; i ++) x[i] = 0.5 * sin(2.0 * M_PI * 20.0 / len * i + 0.3);
+    w.init(len, len / 4);
+    w.process(x, total);
+    w.flush();
+    w.get_power(psd);
+    EXPECT(fabs(psd[20] - 0.125) < 1e-9 && fabs(psd[21] - 0.125 / 4) < 1e-9 && psd[23] < 1e-20,
+           "sine: %g %g %g", psd[20], psd[21], psd[23]);
+    delete [] x;
+    return fails;
+}
+
+/* H{cos} = sin on a block, streaming output against the FIR it documents */
+static int32_t test_hilbert()
+{
+    const int32_t len = 512, total = 6000;
+    int32_t fails = 0, i, t, pos = 0, c = 1;
+    uint32_t seed = 46;
+    double e = 0;
+    WDLFFT<double>::WDL_fft_init();
+
+    static_assert(!std::is_copy_constructible< WDLFFT_Hilbert<double> >::value, "filter must not be copied");
+    static_assert(!std::is_copy_assignable< WDLFFT_Hilbert<double> >::value, "filter must not be copied");
+
+    // block mode: periodic, so whole cycles give exact results
+    double *x = new double[total], *h = new double[len], *env = new double[len];
+    for (i = 0; i < len; i ++) x[i] = 0.7 * cos(2.0 * M_PI * 13 * i / len) + 0.2 * cos(2.0 * M_PI * 100 * i / len + 1);
+    EXPECT(WDLFFT_Hilbert<double>::hilbert(x, h, len) == 0, "hilbert status");
+    for (i = 0; i < len; i ++)
+        e = fmax(e, fabs(h[i] - 0.7 * sin(2.0 * M_PI * 13 * i / len) - 0.2 * sin(2.0 * M_PI * 100 * i / len + 1)));
+    EXPECT(e < 1e-13, "block: error %g", e);
+    for (i = 0; i < len; i ++) x[i] = 0.5 * cos(2.0 * M_PI * 7 * i / len);
+    EXPECT(WDLFFT_Hilbert<double>::envelope(x, env, len) == 0, "envelope status");
+    e = 0;
+    for (i = 0; i < len; i ++) e = fmax(e, fabs(env[i] - 0.5));
+    EXPECT(e < 1e-13, "envelope: error %g", e);
+
+    // lengths real_fft cannot split into a spectrum: -1, outputs untouched
+    static const int32_t bad[] = { -4, 0, 2, 3, 24, 65536 };
+    cmplxT<double> zb[24];
+    for (c = 0; c < (int32_t)(sizeof(bad) / sizeof(bad[0])); c ++)
+    {
+        for (i = 0; i < 24; i ++) h[i] = env[i] = zb[i].re = zb[i].im = -3;
+        EXPECT(WDLFFT_Hilbert<double>::hilbert(x, h, bad[c]) == -1, "hilbert(%d) accepted", bad[c]);
+        EXPECT(WDLFFT_Hilbert<double>::analytic(x, zb, bad[c]) == -1, "analytic(%d) accepted", bad[c]);
+        EXPECT(WDLFFT_Hilbert<double>::envelope(x, env, bad[c]) == -1, "envelope(%d) accepted", bad[c]);
+        for (i = 0; i < 24; i ++)
+            EXPECT(h[i] == -3 && env[i] == -3 && zb[i].re == -3 && zb[i].im == -3, "len %d: output touched at %d", bad[c], i);
+    }
+    c = 1;
+
+    // streaming: re is the delayed input, im the windowed 2/(pi*n) FIR
+    const int32_t taps = len / 8;
+    WDLFFT_Hilbert<double> hb;
+    EXPECT(hb.init(len, taps), "init");
+    const int32_t lat = hb.latency();
+    cmplxT<double> *z = new cmplxT<double>[total];
+    for (i = 0; i < total; i ++) x[i] = test_rand(&seed);
+    while (pos < total)
+    {
+        const int32_t n = c < total - pos ? c : total - pos;
+        hb.process(x + pos, z + pos, n);
+        pos += n;
+        c = c * 7 % 311 + 1;
+    }
+    double er = 0, ei = 0;
+    for (t = 0; t < total; t ++)
+    {
+        double im = 0;
+        for (i = 1; i <= taps; i += 2)
+        {
+            const double a = 2.0 * M_PI * (i + taps) / (2 * taps);
+            const double v = 2.0 / (M_PI * i) * (0.42 - 0.5 * cos(a) + 0.08 * cos(2 * a));
+            const int32_t p = t - lat - i, q = t - lat + i;
+            im += v * ((p >= 0 ? x[p] : 0) - (q >= 0 ? x[q] : 0));
+        }
+        er = fmax(er, fabs(z[t].re - (t >= lat ? x[t - lat] : 0)));
+        ei = fmax(ei, fabs(z[t].im - im));
+    }
+    EXPECT(er < 1e-15 && ei < 1e-12, "streaming: re error %g, im error %g", er, ei);
+    delete [] x;
+    delete [] h;
+    delete [] env;
+    delete [] z;
+    return fails;
+}
+
+/* four-step on memory (several panels) and on files against the DFT */
+static int32_t test_ooc()
+{
+    const int32_t n = 1024;
+    const char *in_path = "wdlfft_tests_ooc.in", *out_path = "wdlfft_tests_ooc.out";
+    int32_t fails = 0, i, inv;
+    uint32_t seed = 47;
+    WDLFFT<double>::WDL_fft_init();
+
+    static_assert(!std::is_copy_constructible< WDLFFT_MappedFile >::value, "mapping must not be copied");
+    static_assert(!std::is_copy_assignable< WDLFFT_MappedFile >::value, "mapping must not be copied");
+
+    cmplxT<double> *x = new cmplxT<double>[n], *y = new cmplxT<double>[n], *r = new cmplxT<double>[n];
+    for (i = 0; i < n; i ++)
+    {
+        x[i].re = test_rand(&seed);
+        x[i].im = test_rand(&seed);
+    }
+    for (inv = 0; inv < 2; inv ++)
+    {
+        // 32 x 32 with 4 KB of panels: 4 columns at a time, so both passes loop
+        EXPECT(WDLFFT_OOC<double>::fft(x, y, n, inv, 4096), "fft");
+        test_dft(r, x, n, inv);
+        const double e = test_err(y, r, n);
+        EXPECT(e < 1e-13, "memory %s: error %g", inv ? "inverse" : "forward", e);
+    }
+    EXPECT(!WDLFFT_OOC<double>::fft(x, y, 3000, 0), "non power of two accepted");
+
+    // real samples through files: X[0..n/2]
+    double *xr = new double[n];
+    for (i = 0; i < n; i ++) xr[i] = test_rand(&seed);
+    FILE *fp = fopen(in_path, "wb");
+    EXPECT(fp && fwrite(xr, sizeof(double), n, fp) == (size_t) n, "writing %s", in_path);
+    if (fp) fclose(fp);
+    EXPECT(WDLFFT_OOC<double>::real_fft_file(in_path, out_path, n, 4096), "real_fft_file");
+    for (i = 0; i < n; i ++)
+    {
+        x[i].re = xr[i];
+        x[i].im = 0;
+    }
+    test_dft(r, x, n, 0);
+    fp = fopen(out_path, "rb");
+    EXPECT(fp && fread(y, sizeof(cmplxT<double>), n / 2 + 1, fp) == (size_t)(n / 2 + 1), "reading %s", out_path);
+    if (fp) fclose(fp);
+    const double e = test_err(y, r, n / 2 + 1);
+    EXPECT(e < 1e-13, "real_fft_file: error %g", e);
+    EXPECT(!WDLFFT_OOC<double>::fft_file("wdlfft_tests_missing.in", out_path, n, 0), "missing input accepted");
+    remove(in_path);
+    remove(out_path);
+
+    delete [] x;
+    delete [] y;
+    delete [] r;
+    delete [] xr;
+    return fails;
+}
+
+/* a worker that keeps up never underruns and the delay is exactly latency(), whatever the block sizes */
+static int32_t test_offload()
+{
+    static const int32_t cfg[][4] = {       // len, hop, slack, max_block
+        { 1024, 256, 0, 100 },
+        { 1024, 256, 0, 256 },
+        { 512, 128, 37, 1 },
+        { 2048, 512, 64, 300 },
+    };
+    const int32_t total = 20000;
+    int32_t fails = 0, c, i, varied;
+    uint32_t seed = 49;
+    WDLFFT<double>::WDL_fft_init();
+
+    static_assert(!std::is_copy_constructible< WDLFFT_SPSC<double> >::value, "ring must not be copied");
+    static_assert(!std::is_copy_constructible< WDLFFT_Offload<double> >::value, "offload must not be copied");
+
+    double *x = new double[total], *y = new double[total];
+    for (i = 0; i < total; i ++) x[i] = test_rand(&seed);
+
+    for (c = 0; c < (int32_t)(sizeof(cfg) / sizeof(cfg[0])); c ++)
+        for (varied = 0; varied < 2; varied ++)
+        {
+            const int32_t len = cfg[c][0], mb = cfg[c][3];
+            WDLFFT_Offload<double> off;
+            EXPECT(off.init(len, cfg[c][1], cfg[c][2], mb, 0, 0), "init %d", c);
+            const int32_t lat = off.latency();
+            EXPECT(lat == len + cfg[c][2] + mb - 1, "config %d: latency %d", c, lat);
+
+            // no thread: the worker runs every ready hop right before each audio block
+            int32_t pos = 0;
+            while (pos < total)
+            {
+                int32_t n = varied ? 1 + (int32_t)((test_rand(&seed) + 1.0) * 0.5 * mb) : mb;
+                if (n > mb) n = mb;
+                if (n > total - pos) n = total - pos;
+                off.work();
+                off.process(x + pos, y + pos, n);
+                pos += n;
+            }
+            EXPECT(!off.underruns() && !off.overruns(), "config %d%s: %lld underruns, %lld overruns", c,
+                   varied ? " varied blocks" : "", (long long) off.underruns(), (long long) off.overruns());
+
+            // plain delay once the first frame has filled; silence before the delayed input starts
+            double e = 0;
+            for (i = 0; i < total; i ++)
+            {
+                const double r = i >= lat + len ? x[i - lat] : i < lat ? 0 : y[i];
+                e = fmax(e, fabs(y[i] - r));
+            }
+            EXPECT(e < 1e-12, "config %d%s: delay error %g", c, varied ? " varied blocks" : "", e);
+        }
+    delete [] x;
+    delete [] y;
+    return fails;
+}
+
+/* exact against schoolbook, on both sides of the 32768-point switch to the four-step */
+static int32_t test_bigmul()
+{
+    static const int32_t cfg[][3] = { { 1, 1, 32 }, { 300, 257, 16 }, { 1000, 700, 24 }, { 20000, 17000, 16 } };
+    int32_t fails = 0, c, i, j;
+    uint32_t seed = 50;
+
+    for (c = 0; c < (int32_t)(sizeof(cfg) / sizeof(cfg[0])); c ++)
+    {
+        const int32_t na = cfg[c][0], nb = cfg[c][1], bits = cfg[c][2];
+        const uint64_t mask = bits == 32 ? 0xffffffffu : ((uint64_t) 1 << bits) - 1;
+        uint32_t *a = new uint32_t[na], *b = new uint32_t[nb];
+        uint64_t *r = new uint64_t[na + nb - 1], *z = new uint64_t[na + nb - 1];
+        double err = 1;
+
+        // all-ones operands first: the largest possible outputs
+        for (i = 0; i < na; i ++) a[i] = (uint32_t)(i < 16 ? mask : (seed = seed * 1664525u + 1013904223u) & mask);
+        for (i = 0; i < nb; i ++) b[i] = (uint32_t)(i < 16 ? mask : (seed = seed * 1664525u + 1013904223u) & mask);
+        memset(r, 0, (na + nb - 1) * sizeof(uint64_t));
+        for (i = 0; i < na; i ++)
+            for (j = 0; j < nb; j ++) r[i + j] += (uint64_t) a[i] * b[j];
+
+        EXPECT(WDLFFT_BigMul::convolve(a, na, b, nb, z, bits, &err), "%dx%d, %d bits: failed, error %g", na, nb, bits, err);
+        EXPECT(!memcmp(r, z, (na + nb - 1) * sizeof(uint64_t)), "%dx%d, %d bits: wrong product", na, nb, bits);
+        EXPECT(err < 0.25, "%dx%d: rounding error %g", na, nb, err);
+        delete [] a;
+        delete [] b;
+        delete [] r;
+        delete [] z;
+    }
+
+    // big numbers: (2^(16n) - 1)^2 has every carry chain at its longest
+    const int32_t n = 3000;
+    uint16_t *x = new uint16_t[n], *p = new uint16_t[2 * n];
+    uint32_t *q = new uint32_t[2 * n];
+    for (i = 0; i < n; i ++) x[i] = 0xffff;
+    EXPECT(WDLFFT_BigMul::multiply(x, n, x, n, p), "multiply");
+    for (i = 0; i < 2 * n; i ++) EXPECT(p[i] == (i == 0 ? 1 : i < n ? 0 : i == n ? 0xfffe : 0xffff), "limb %d: %x", i, p[i]);
+
+    for (i = 0; i < n; i ++) x[i] = (uint16_t)((seed = seed * 1664525u + 1013904223u) >> 16);
+    EXPECT(WDLFFT_BigMul::multiply(x, n, x, 1000, p), "multiply %dx1000", n);
+    memset(q, 0, (n + 1000) * sizeof(uint32_t));
+    for (i = 0; i < n; i ++)
+    {
+        uint64_t carry = 0;
+        for (j = 0; j < 1000; j ++)
+        {
+            carry += (uint64_t) x[i] * x[j] + q[i + j];
+            q[i + j] = (uint32_t)(carry & 0xffff);
+            carry >>= 16;
+        }
+        for (j = i + 1000; carry; j ++)
+        {
+            carry += q[j];
+            q[j] = (uint32_t)(carry & 0xffff);
+            carry >>= 16;
+        }
+    }
+    for (i = 0; i < n + 1000; i ++) EXPECT(p[i] == q[i], "limb %d: %x, expected %x", i, p[i], q[i]);
+
+    EXPECT(!WDLFFT_BigMul::convolve((const uint32_t *) q, 0, (const uint32_t *) q, 1, (uint64_t *) q, 16), "empty input accepted");
+    delete [] x;
+    delete [] p;
+    delete [] q;
+    return fails;
+}
+
+struct test_t {
+    const char *name;
+    int32_t (*fn)();
+};
+
+static const test_t g_tests[] = {
+    { "reference", test_reference },
+    { "bluestein", test_bluestein },
+    { "dct", test_dct },
+    { "nd", test_nd },
+    { "lanes", test_lanes },
+#if __cplusplus >= 201703L
+    { "fft_n", test_fft_n },
+#endif
+    { "arena", test_arena },
+    { "planner", test_planner },
+#ifdef WDL_FFT_STATS
+    { "stats", test_stats },
+#endif
+    { "denormal", test_denormal },
+    { "fixed", test_fixed },
+    { "real_fft2", test_real_fft2 },
+    { "pfb", test_pfb },
+    { "pvoc", test_pvoc },
+    { "cqt", test_cqt },
+    { "welch", test_welch },
+    { "hilbert", test_hilbert },
+    { "ooc", test_ooc },
+    { "offload", test_offload },
+    { "bigmul", test_bigmul },
+};
+
+int main(int argc, char **argv)
+{
+    const int32_t count = (int32_t)(sizeof(g_tests) / sizeof(g_tests[0]));
+    int32_t i, a, failed = 0, ran = 0;
+    bool named = false;
+
+    for (a = 1; a < argc; a ++)
+    {
+        if (!strcmp(argv[a], "-full")) g_max_len = 1 << FFT_MAXBITLEN;
+        else named = true;
+    }
+
+#ifdef WDL_FFT_CONSTEXPR_TABLES
+    printf("wdlfft-tests (constexpr tables)\n");
+#else
+    printf("wdlfft-tests\n");
+#endif
+    for (i = 0; i < count; i ++)
+    {
+        bool run = !named;
+        for (a = 1; a < argc && !run; a ++) run = !strcmp(argv[a], g_tests[i].name);
+        if (!run) continue;
+
+        const int32_t f = g_tests[i].fn() + g_alloc_fails;     // stray arena failures count too
+        g_alloc_fails = 0;
+        printf("%-12s %s\n", g_tests[i].name, f ? "FAIL" : "ok");
+        failed += f != 0;
+        ran ++;
+    }
+    printf("%d of %d tests failed\n", failed, ran);
+    return failed != 0;
+}
@@ -0,0 +1,505 @@
+/*
+ **  wdlfft-spectrogram: batch magnitude spectrograms with WDLFFT
+ **
+ **  C++ wrapper (C)2024 DEMOS
+ **  GITHUB: https://github.com/mewza or Email: subband@protonmail.com
+ **  LICENSE: same as wdlfft.h
+ **
+ **  Build from the repo root (one translation unit, no other sources):
+ **
+ **    c++ -std=c++17 -O2 -pthread -I. tools/wdlfft_spectrogram.cpp -o wdlfft-spectrogram
+ **
+ **  Usage:
+ **
+ **    wdlfft-spectrogram [options] input...
+ **
+ **      -n N       frame size, power of two 16..32768 (default 2048)
+ **      -h H       hop in samples (default N/4)
+ **      -t T       worker threads (default: hardware threads)
+ **      -q u16|f32 output values (default u16)
+ **      -o PATH    output file (one input) or directory (several);
+ **                 default input path + ".wdls"
+ **      -raw f32|s16 -r RATE -c CH
+ **                 inputs without a RIFF header are raw samples in this
+ **                 format (default f32, 48000 Hz, 1 channel)
+ **
+ **  Inputs are WAV (PCM 16/24/32 bit, float32, WAVE_FORMAT_EXTENSIBLE)
+ **  or raw interleaved samples; channels are averaged to mono. Input and
+ **  output files are memory mapped (WDLFFT_MappedFile). Each file is cut
+ **  into jobs of up to 1024 frames, and a pool of workers takes jobs from
+ **  a shared counter: one big file spreads over every worker, many small
+ **  files go one or more per worker. Frames run through a periodic Hann
+ **  window and WDLFFT<float>::real_fft and are written straight into
+ **  their slot of the output, so workers never wait on each other.
+ **
+ **  Output (.wdls, little endian on every platform that matters here):
+ **
+ **    char     magic[4]    "WDLS"
+ **    uint32   version     1
+ **    uint32   header      header size in bytes (40)
+ **    uint32   fft_size
+ **    uint32   hop
+ **    uint32   bins        fft_size/2 + 1
+ **    uint64   frames
+ **    float    rate        sample rate, Hz
+ **    uint32   format      0 = u16, 1 = f32
+ **    then frames * bins values, frame-major, bin 0 (DC) first
+ **
+ **  Values are magnitudes scaled so a full-scale sine reads 1.0 at its
+ **  bin. f32 stores them as is; u16 stores 256 * (dB + 200) rounded and
+ **  clamped to 0..65535, so -200..+56 dB in 1/256 dB steps.
+ **
+ **  At the end it prints frames, frames/s, MB/s of input, the buffers
+ **  the workers hold and the process's peak resident set to stderr.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef F_COS
+#define F_COS cos
+#define F_SIN sin
+#endif
+
+#include "wdlfft.h"
+#include "wdlfft_ooc.h"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+DECL_WDLFFT(float)
+
+enum { FMT_S16, FMT_S24, FMT_S32, FMT_F32 };
+enum { OUT_U16, OUT_F32 };
+
+static const uint32_t HEADER_SIZE = 40;
+static const int64_t JOB_FRAMES = 1024;
+
+struct input_t {
+    std::string path, out_path;
+    WDLFFT_MappedFile in, out;
+    const uint8_t *data;    // first sample frame
+    int64_t samples;        // per channel
+    int32_t channels, format;
+    double rate;
+    int64_t frames;
+};
+
+struct job_t {
+    input_t *file;
+    int64_t frame0, count;
+};
+
+static uint32_t rd16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static uint32_t rd32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24); }
+
+static void wr32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t) v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static int32_t sample_bytes(int32_t format)
+{
+    return format == FMT_S16 ? 2 : format == FMT_S24 ? 3 : 4;
+}
+
+/* finds "fmt " and "data" in a RIFF/WAVE file; false if it is not one we read */
+static bool parse_wav(input_t &f, const char **err)
+{
+    const uint8_t *p = (const uint8_t *) f.in.data();
+    const uint64_t size = f.in.size();
+    uint64_t pos = 12;
+    bool have_fmt = false;
+    uint32_t tag = 0, bits = 0;
+
+    while (pos + 8 <= size)
+    {
+        const uint32_t len = rd32(p + pos + 4);
+        const uint8_t *c = p + pos + 8;
+        const bool whole = pos + 8 + len <= size;
+        if (!memcmp(p + pos, "fmt ", 4) && len >= 16)
+        {
+            if (!whole) { *err = "truncated fmt chunk"; return false; }
+            tag = rd16(c);
+            f.channels = (int32_t) rd16(c + 2);
+            f.rate = rd32(c + 4);
+            bits = rd16(c + 14);
+            if (tag == 0xfffe && len >= 26) tag = rd16(c + 24);   // extensible: subformat GUID
+            have_fmt = true;
+        } else if (!memcmp(p + pos, "data", 4) && have_fmt)
+        {
+            if (tag == 1 && bits == 16) f.format = FMT_S16;
+            else if (tag == 1 && bits == 24) f.format = FMT_S24;
+            else if (tag == 1 && bits == 32) f.format = FMT_S32;
+            else if (tag == 3 && bits == 32) f.format = FMT_F32;
+            else { *err = "unsupported WAV sample format"; return false; }
+            if (f.channels < 1) { *err = "bad channel count"; return false; }
+
+            // a data chunk cut short (or streamed with a placeholder length) stops at the end of the file
+            const uint64_t avail = whole ? len : size - (pos + 8);
+            f.data = c;
+            f.samples = (int64_t)(avail / ((uint64_t) sample_bytes(f.format) * f.channels));
+            return true;
+        }
+        pos += 8 + (uint64_t) len + (len & 1);
+    }
+    *err = have_fmt ? "no data chunk" : "no fmt chunk";
+    return false;
+}
+
+template <int32_t F> static inline float read_sample(const uint8_t *p)
+{
+    switch (F)
+    {
+        case FMT_S16: return (float)(int16_t) rd16(p) * (1.0f / 32768.0f);
+        case FMT_S24: return (float)((int32_t)(rd32(p - 1) & 0xffffff00) >> 8) * (1.0f / 8388608.0f);   // p - 1 is still in the file
+        case FMT_S32: return (float)(int32_t) rd32(p) * (1.0f / 2147483648.0f);
+        default:
+        {
+            float v;
+            memcpy(&v, p, 4);
+            return v;
+        }
+    }
+}
+
+template <int32_t F> static void decode_as(const uint8_t *p, int32_t ch, int64_t n, float *dst)
+{
+    const int32_t sb = F == FMT_S16 ? 2 : F == FMT_S24 ? 3 : 4;
+    const float g = 1.0f / ch;
+    int64_t i;
+    int32_t c;
+
+    if (ch == 1)
+    {
+        for (i = 0; i < n; i ++) dst[i] = read_sample<F>(p + i * sb);
+        return;
+    }
+    for (i = 0; i < n; i ++)
+    {
+        float acc = 0;
+        for (c = 0; c < ch; c ++, p += sb) acc += read_sample<F>(p);
+        dst[i] = acc * g;
+    }
+}
+
+/* mono float from interleaved samples [s0, s0 + n) of f */
+static void decode(const input_t &f, int64_t s0, int64_t n, float *dst)
+{
+    const uint8_t *p = f.data + (uint64_t) s0 * f.channels * sample_bytes(f.format);
+    switch (f.format)
+    {
+        case FMT_S16: decode_as<FMT_S16>(p, f.channels, n, dst); break;
+        case FMT_S24: decode_as<FMT_S24>(p, f.channels, n, dst); break;
+        case FMT_S32: decode_as<FMT_S32>(p, f.channels, n, dst); break;
+        default: decode_as<FMT_F32>(p, f.channels, n, dst);
+    }
+}
+
+/*
+ * 10*log10(p) for normal p > 0 from the exponent plus the atanh series of
+ * the mantissa folded into [sqrt(1/2), sqrt(2)): |error| < 5e-5 dB, far
+ * below the 1/256 dB output step, and it vectorizes where log10f does not
+ */
+static inline float power_db(float p)
+{
+    uint32_t u;
+    float m;
+    memcpy(&u, &p, 4);
+    int32_t e = (int32_t)((u >> 23) & 255) - 127;
+    u = (u & 0x7fffff) | 0x3f800000;
+    memcpy(&m, &u, 4);
+    if (m > 1.41421356f) { m *= 0.5f; e ++; }
+    const float t = (m - 1.0f) / (m + 1.0f), t2 = t * t;
+    const float ln = 2.0f * t * (1.0f + t2 * (1.0f / 3.0f + t2 * (0.2f + t2 * (1.0f / 7.0f))));
+    return 4.34294482f * ((float) e * 0.693147181f + ln);
+}
+
+struct options_t {
+    int32_t n, hop, threads, out_format;
+    int32_t raw_format, raw_channels;
+    double raw_rate;
+    const char *out;
+};
+
+/* takes jobs until none are left; counts itself in failed and takes none if its buffers cannot be allocated */
+static void worker(std::vector<job_t> *jobs, std::atomic<int64_t> *next, const options_t *opt, const float *win, float norm,
+                   std::atomic<int32_t> *failed)
+{
+    const float norm2 = norm * norm;
+    const int32_t n = opt->n, half = n / 2, bins = half + 1;
+    const int32_t *perm = WDLFFT<float>::WDL_fft_permute_tab(half);
+    float *samples = (float *) WDL_fft_aligned_alloc(((JOB_FRAMES - 1) * opt->hop + n) * sizeof(float));
+    float *work = (float *) WDL_fft_aligned_alloc(n * sizeof(float));
+    float *pw = (float *) WDL_fft_aligned_alloc(bins * sizeof(float));
+    int64_t j;
+
+    if (!samples || !work || !pw)
+    {
+        WDL_fft_aligned_free(samples);
+        WDL_fft_aligned_free(work);
+        WDL_fft_aligned_free(pw);
+        (*failed) ++;
+        return;
+    }
+
+    while ((j = (*next) ++) < (int64_t) jobs->size())
+    {
+        const job_t &job = (*jobs)[j];
+        const input_t &f = *job.file;
+        const int64_t s0 = job.frame0 * opt->hop;
+        int64_t t;
+        int32_t i, k;
+
+        decode(f, s0, (job.count - 1) * opt->hop + n, samples);
+
+        uint8_t *dst = (uint8_t *) f.out.data() + HEADER_SIZE +
+                       (uint64_t) job.frame0 * bins * (opt->out_format == OUT_U16 ? 2 : 4);
+        for (t = 0; t < job.count; t ++)
+        {
+            const float *x = samples + t * opt->hop;
+            for (i = 0; i < n; i ++) work[i] = x[i] * win[i];
+            WDLFFT<float>::real_fft(work, n, 0);
+
+            // power first: u16 takes power_db of it directly, f32 the root
+            const cmplxT<float> *s = (const cmplxT<float> *) work;
+            pw[0] = s[0].re * s[0].re * norm2 * 0.25f;     // DC and Nyquist are not doubled
+            pw[half] = s[0].im * s[0].im * norm2 * 0.25f;
+            for (k = 1; k < half; k ++)
+            {
+                const cmplxT<float> &v = s[perm[k]];
+                pw[k] = (v.re * v.re + v.im * v.im) * norm2;
+            }
+
+            if (opt->out_format == OUT_F32)
+            {
+                float *o = (float *) dst;
+                for (k = 0; k < bins; k ++) o[k] = sqrtf(pw[k]);
+                dst += bins * sizeof(float);
+            } else
+            {
+                uint16_t *q = (uint16_t *) dst;
+                for (k = 0; k < bins; k ++)
+                {
+                    const float db = power_db(pw[k] > 1e-20f ? pw[k] : 1e-20f);
+                    float v = (db + 200.0f) * 256.0f + 0.5f;
+                    v = v < 0 ? 0 : v > 65535.0f ? 65535.0f : v;
+                    q[k] = (uint16_t) v;
+                }
+                dst += bins * sizeof(uint16_t);
+            }
+        }
+    }
+
+    WDL_fft_aligned_free(samples);
+    WDL_fft_aligned_free(work);
+    WDL_fft_aligned_free(pw);
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: wdlfft-spectrogram [-n N] [-h HOP] [-t THREADS] [-q u16|f32] [-o PATH]\n"
+            "                          [-raw f32|s16] [-r RATE] [-c CH] input...\n");
+}
+
+static bool is_dir(const char *path)
+{
+#ifdef _WIN32
+    const DWORD a = GetFileAttributesA(path);
+    return a != INVALID_FILE_ATTRIBUTES && (a & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat st;
+    return !stat(path, &st) && S_ISDIR(st.st_mode);
+#endif
+}
+
+static std::string base_name(const std::string &p)
+{
+    const size_t s = p.find_last_of("/\\");
+    return s == std::string::npos ? p : p.substr(s + 1);
+}
+
+int main(int argc, char **argv)
+{
+    options_t opt;
+    std::vector<input_t *> files;
+    int32_t i;
+
+    opt.n = 2048;
+    opt.hop = 0;
+    opt.threads = (int32_t) std::thread::hardware_concurrency();
+    opt.out_format = OUT_U16;
+    opt.raw_format = FMT_F32;
+    opt.raw_channels = 1;
+    opt.raw_rate = 48000;
+    opt.out = 0;
+
+    for (i = 1; i < argc; i ++)
+    {
+        const char *a = argv[i], *v = i + 1 < argc ? argv[i + 1] : 0;
+        if (a[0] != '-') { files.push_back(new input_t); files.back()->path = a; continue; }
+        if (!v) { usage(); return 2; }
+        if (!strcmp(a, "-n")) opt.n = atoi(v);
+        else if (!strcmp(a, "-h")) opt.hop = atoi(v);
+        else if (!strcmp(a, "-t")) opt.threads = atoi(v);
+        else if (!strcmp(a, "-q")) opt.out_format = !strcmp(v, "f32") ? OUT_F32 : OUT_U16;
+        else if (!strcmp(a, "-o")) opt.out = v;
+        else if (!strcmp(a, "-raw")) opt.raw_format = !strcmp(v, "s16") ? FMT_S16 : FMT_F32;
+        else if (!strcmp(a, "-r")) opt.raw_rate = atof(v);
+        else if (!strcmp(a, "-c")) opt.raw_channels = atoi(v);
+        else { usage(); return 2; }
+        i ++;
+    }
+    if (!opt.hop) opt.hop = opt.n / 4;
+    if (opt.threads < 1) opt.threads = 1;
+    if (files.empty() || opt.n < 16 || opt.n > (1 << FFT_MAXBITLEN) || (opt.n & (opt.n - 1)) ||
+        opt.hop < 1 || opt.raw_channels < 1)
+    {
+        usage();
+        return 2;
+    }
+    const bool out_dir = opt.out && (files.size() > 1 || is_dir(opt.out));
+
+    WDLFFT<float>::WDL_fft_init();
+
+    const int32_t bins = opt.n / 2 + 1, vbytes = opt.out_format == OUT_U16 ? 2 : 4;
+    std::vector<job_t> jobs;
+    uint64_t in_bytes = 0;
+    int64_t total_frames = 0;
+    int ret = 0;
+
+    for (input_t *f : files)
+    {
+        const char *err = 0;
+        if (!f->in.open(f->path.c_str(), 0))
+        {
+            fprintf(stderr, "%s: cannot open\n", f->path.c_str());
+            ret = 1;
+            continue;
+        }
+
+        const uint8_t *p = (const uint8_t *) f->in.data();
+        if (f->in.size() >= 12 && !memcmp(p, "RIFF", 4) && !memcmp(p + 8, "WAVE", 4))
+        {
+            if (!parse_wav(*f, &err))
+            {
+                fprintf(stderr, "%s: %s\n", f->path.c_str(), err);
+                f->in.close();
+                ret = 1;
+                continue;
+            }
+        } else
+        {
+            f->format = opt.raw_format;
+            f->channels = opt.raw_channels;
+            f->rate = opt.raw_rate;
+            f->data = p;
+            f->samples = (int64_t)(f->in.size() / ((uint64_t) sample_bytes(f->format) * f->channels));
+        }
+
+        f->frames = f->samples >= opt.n ? (f->samples - opt.n) / opt.hop + 1 : 0;
+        f->out_path = !opt.out ? f->path + ".wdls" : out_dir ? std::string(opt.out) + "/" + base_name(f->path) + ".wdls" : opt.out;
+        if (!f->out.open(f->out_path.c_str(), HEADER_SIZE + (uint64_t) f->frames * bins * vbytes))
+        {
+            fprintf(stderr, "%s: cannot create\n", f->out_path.c_str());
+            f->in.close();
+            ret = 1;
+            continue;
+        }
+
+        uint8_t *h = (uint8_t *) f->out.data();
+        const float rate = (float) f->rate;
+        uint32_t rate_bits;
+        memcpy(&rate_bits, &rate, 4);
+        memcpy(h, "WDLS", 4);
+        wr32(h + 4, 1);
+        wr32(h + 8, HEADER_SIZE);
+        wr32(h + 12, (uint32_t) opt.n);
+        wr32(h + 16, (uint32_t) opt.hop);
+        wr32(h + 20, (uint32_t) bins);
+        wr32(h + 24, (uint32_t) f->frames);
+        wr32(h + 28, (uint32_t)((uint64_t) f->frames >> 32));
+        wr32(h + 32, rate_bits);
+        wr32(h + 36, (uint32_t) opt.out_format);
+
+        int64_t t;
+        for (t = 0; t < f->frames; t += JOB_FRAMES)
+        {
+            job_t j;
+            j.file = f;
+            j.frame0 = t;
+            j.count = f->frames - t < JOB_FRAMES ? f->frames - t : JOB_FRAMES;
+            jobs.push_back(j);
+        }
+        in_bytes += f->in.size();
+        total_frames += f->frames;
+    }
+
+    // periodic Hann; norm makes a full-scale sine read 1.0: |2X| * 2 / (2 * sum(w))
+    float *win = (float *) WDL_fft_aligned_alloc(opt.n * sizeof(float));
+    double wsum = 0;
+    if (!win)
+    {
+        fprintf(stderr, "out of memory\n");
+        for (input_t *f : files) delete f;
+        return 1;
+    }
+    for (i = 0; i < opt.n; i ++)
+    {
+        win[i] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * i / opt.n));
+        wsum += win[i];
+    }
+    const float norm = (float)(1.0 / wsum);
+
+    const int32_t nthreads = (int64_t) opt.threads < (int64_t) jobs.size() ? opt.threads : (int32_t) jobs.size();
+    std::atomic<int64_t> next(0);
+    std::atomic<int32_t> failed(0);
+    std::vector<std::thread> pool;
+    const auto t0 = std::chrono::steady_clock::now();
+
+    for (i = 0; i < nthreads; i ++) pool.push_back(std::thread(worker, &jobs, &next, &opt, win, norm, &failed));
+    for (std::thread &th : pool) th.join();
+
+    // the healthy workers take every job; with none left the outputs are incomplete
+    if (failed > 0 && failed == nthreads)
+    {
+        fprintf(stderr, "out of memory for worker buffers, outputs are incomplete\n");
+        ret = 1;
+    } else if (failed > 0)
+        fprintf(stderr, "%d of %d worker(s) could not allocate buffers\n", (int) failed, nthreads);
+
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    const double work_mb = (double) nthreads * (((JOB_FRAMES - 1) * opt.hop + opt.n) * 4.0 + opt.n * 4.0 + bins * 4.0) / 1048576.0;
+
+    fprintf(stderr, "%d file(s), %lld frames of %d (hop %d), %d thread(s): %.3f s, %.0f frames/s, %.1f MB/s in\n",
+            (int) files.size(), (long long) total_frames, opt.n, opt.hop, nthreads, secs,
+            secs > 0 ? total_frames / secs : 0.0, secs > 0 ? in_bytes / secs / 1e6 : 0.0);
+#ifndef _WIN32
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+    const double rss_mb = ru.ru_maxrss / 1048576.0;     // bytes
+#else
+    const double rss_mb = ru.ru_maxrss / 1024.0;        // KB
+#endif
+    fprintf(stderr, "memory: %.2f MB worker buffers, %.1f MB peak resident (includes mapped file pages)\n", work_mb, rss_mb);
+#else
+    fprintf(stderr, "memory: %.2f MB worker buffers\n", work_mb);
+#endif
+
+    WDL_fft_aligned_free(win);
+    for (input_t *f : files) delete f;
+    return ret;
+}
@@ -18,8 +18,23 @@
 #pragma once
 
 #include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#if defined(__has_include)
+#if __has_include(<simd/simd.h>)
+#include <simd/simd.h>          // simd_float8 etc.; scalar float / double need nothing
+#endif
+#else
 #include <simd/simd.h>
+#endif
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#endif
 
 #ifndef CMPLX_T_TYPE
 #define CMPLX_T_TYPE
@@ -32,12 +47,544 @@ struct cmplxT {
 
 #endif // CMPLX_T_TYPE
 
+#ifndef WDL_FFT_ALIGN
+#define WDL_FFT_ALIGN           64 // AVX-512 / cache line
+#endif
+
+/*
+ * #define WDL_FFT_ALIGNED to promise that every buffer handed to the
+ * kernels is WDL_FFT_ALIGN aligned (WDLFFT<T>::alloc_buffer or the
+ * scratch arena below), so the passes may use aligned loads/stores.
+ */
+#ifdef WDL_FFT_ALIGNED
+#define WDL_FFT_ASSUME_ALIGNED(p) ((decltype(p))__builtin_assume_aligned((p), WDL_FFT_ALIGN))
+#else
+#define WDL_FFT_ASSUME_ALIGNED(p) (p)
+#endif
+
+static inline void *WDL_fft_aligned_alloc(size_t sz)
+{
+    void *p = 0;
+    sz = (sz + WDL_FFT_ALIGN - 1) & ~(size_t)(WDL_FFT_ALIGN - 1);
+#ifdef _WIN32
+    p = _aligned_malloc(sz ? sz : WDL_FFT_ALIGN, WDL_FFT_ALIGN);
+#else
+    if (posix_memalign(&p, WDL_FFT_ALIGN, sz ? sz : WDL_FFT_ALIGN)) p = 0;
+#endif
+    return p;
+}
+
+static inline void WDL_fft_aligned_free(void *p)
+{
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+/*
+ * Per-thread scratch arena. Allocations are WDL_FFT_ALIGN aligned and
+ * released in stack order (see WDLFFT_Scratch); the blocks are kept for
+ * the life of the thread, so once a thread has seen its largest
+ * transform no further heap allocation happens. Call reserve() up front
+ * on real-time threads.
+ *
+ * Running out of blocks (MAX_BLOCKS, each twice the last) or out of
+ * memory prints the request size and runs WDL_FFT_ALLOC_FAIL (abort()
+ * unless defined): none of the transforms built on the arena can carry
+ * on without its scratch, so callers do not check. A replacement should
+ * throw or not return; if it returns, alloc() gives 0.
+ */
+#ifndef WDL_FFT_ALLOC_FAIL
+#define WDL_FFT_ALLOC_FAIL() abort()
+#endif
+
+class WDLFFT_Arena {
+public:
+
+    struct mark_t { int32_t blk; size_t used; };
+
+    WDLFFT_Arena() : m_nblk(0), m_cur(0), m_used(0) { }
+
+    ~WDLFFT_Arena()
+    {
+        int32_t i;
+        for (i = 0; i < m_nblk; i ++) WDL_fft_aligned_free(m_blk[i].mem);
+    }
+
+    static WDLFFT_Arena &thread()
+    {
+        static thread_local WDLFFT_Arena a;
+        return a;
+    }
+
+    void *alloc(size_t sz)
+    {
+        sz = (sz + WDL_FFT_ALIGN - 1) & ~(size_t)(WDL_FFT_ALIGN - 1);
+        for (;;)
+        {
+            if (m_cur < m_nblk)
+            {
+                if (m_used + sz <= m_blk[m_cur].size)
+                {
+                    void *p = m_blk[m_cur].mem + m_used;
+                    m_used += sz;
+                    return p;
+                }
+                if (m_cur + 1 < m_nblk)
+                {
+                    m_cur ++;
+                    m_used = 0;
+                    continue;
+                }
+            }
+            if (m_nblk == MAX_BLOCKS)
+            {
+                fail(sz, "out of blocks");
+                return 0;
+            }
+
+            size_t bsz = m_nblk ? m_blk[m_nblk - 1].size * 2 : 65536;
+            while (bsz < sz) bsz *= 2;
+            char *mem = (char *)WDL_fft_aligned_alloc(bsz);
+            if (!mem)
+            {
+                fail(sz, "out of memory");
+                return 0;
+            }
+            m_blk[m_nblk].mem = mem;
+            m_blk[m_nblk].size = bsz;
+            m_cur = m_nblk ++;
+            m_used = 0;
+        }
+    }
+
+    mark_t mark() const
+    {
+        mark_t m = { m_cur, m_used };
+        return m;
+    }
+
+    void release(mark_t m)
+    {
+        m_cur = m.blk;
+        m_used = m.used;
+    }
+
+    /* makes sure a single alloc(sz) from an empty arena needs no heap */
+    void reserve(size_t sz)
+    {
+        int32_t i;
+        for (i = 0; i < m_nblk; i ++) if (m_blk[i].size >= sz) return;
+
+        const mark_t m = mark();
+        m_cur = m_nblk; // past the last block, so alloc() appends one
+        alloc(sz);
+        release(m);
+    }
+
+private:
+
+    enum { MAX_BLOCKS = 32 };
+    struct block { char *mem; size_t size; };
+
+    static void fail(size_t sz, const char *why)
+    {
+        fprintf(stderr, "wdlfft: scratch arena: %s allocating %zu bytes\n", why, sz);
+        WDL_FFT_ALLOC_FAIL();
+    }
+
+    block m_blk[MAX_BLOCKS];
+    int32_t m_nblk, m_cur;
+    size_t m_used;
+};
+
+/* Scoped scratch from the calling thread's arena, freed on scope exit. */
+class WDLFFT_Scratch {
+public:
+
+    WDLFFT_Scratch() : m_arena(WDLFFT_Arena::thread()), m_mark(m_arena.mark()) { }
+    ~WDLFFT_Scratch() { m_arena.release(m_mark); }
+
+    template <typename X> X *get(size_t n) { return (X *)m_arena.alloc(n * sizeof(X)); }
+
+private:
+
+    WDLFFT_Arena &m_arena;
+    WDLFFT_Arena::mark_t m_mark;
+};
+
+/*
+ * Scoped flush-to-zero: sets FTZ and DAZ (x86 MXCSR) or FZ (ARM FPCR /
+ * FPSCR) for the current thread and restores the previous mode on
+ * destruction. If the bits are already set (most audio hosts do this)
+ * neither constructor nor destructor writes the register. Elsewhere it
+ * does nothing.
+ *
+ * #define WDL_FFT_FTZ to put one inside every fft, real_fft and
+ * WDL_fft_complexmul* call, or wrap a block of calls in one yourself.
+ */
+class WDLFFT_DenormalGuard {
+public:
+
+    WDLFFT_DenormalGuard() : m_old(get())
+    {
+        if ((m_old & BITS) != BITS) set(m_old | BITS);
+    }
+
+    ~WDLFFT_DenormalGuard()
+    {
+        if ((m_old & BITS) != BITS) set(m_old);
+    }
+
+private:
+
+    // restores the mode it saw on construction, once
+    WDLFFT_DenormalGuard(const WDLFFT_DenormalGuard &);
+    WDLFFT_DenormalGuard &operator=(const WDLFFT_DenormalGuard &);
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    typedef unsigned int reg_t;
+    static const reg_t BITS = 0x8040; // FTZ | DAZ
+    static reg_t get() { return _mm_getcsr(); }
+    static void set(reg_t v) { _mm_setcsr(v); }
+#elif defined(__aarch64__)
+    typedef uint64_t reg_t;
+    static const reg_t BITS = 1 << 24; // FZ
+    static reg_t get() { reg_t v; __asm__ __volatile__("mrs %0, fpcr" : "=r"(v)); return v; }
+    static void set(reg_t v) { __asm__ __volatile__("msr fpcr, %0" : : "r"(v)); }
+#elif defined(__arm__) && defined(__ARM_FP)
+    typedef uint32_t reg_t;
+    static const reg_t BITS = 1 << 24; // FZ
+    static reg_t get() { reg_t v; __asm__ __volatile__("vmrs %0, fpscr" : "=r"(v)); return v; }
+    static void set(reg_t v) { __asm__ __volatile__("vmsr fpscr, %0" : : "r"(v)); }
+#else
+    typedef int reg_t;
+    static const reg_t BITS = 0;
+    static reg_t get() { return 0; }
+    static void set(reg_t) { }
+#endif
+
+    const reg_t m_old;
+};
+
+#ifdef WDL_FFT_FTZ
+#define WDL_FFT_FTZ_SCOPE WDLFFT_DenormalGuard wdl_fft_ftz_guard
+#else
+#define WDL_FFT_FTZ_SCOPE
+#endif
+
+/* scalar of T: T itself, or the lane type of a vector T */
+template <typename T, bool = std::is_arithmetic<T>::value>
+struct wdl_fft_scalar { typedef T type; };
+
+template <typename T>
+struct wdl_fft_scalar<T, false> { typedef typename std::decay<decltype(std::declval<T &>()[0])>::type type; };
+
+#if __cplusplus >= 201703L
+
+/* Taylor series, good to double precision for |x| <= pi/2 */
+static constexpr double wdl_fft_csin(double x)
+{
+    double t = x, s = x;
+    for (int k = 1; k < 15; k ++) { t *= -x * x / ((2 * k) * (2 * k + 1)); s += t; }
+    return s;
+}
+
+static constexpr double wdl_fft_ccos(double x)
+{
+    double t = 1, s = 1;
+    for (int k = 1; k < 15; k ++) { t *= -x * x / ((2 * k - 1) * (2 * k)); s += t; }
+    return s;
+}
+
+/*
+ * Constexpr twin of the d##N twiddles: exp(2*pi*i*(x+1)/N), N/4-1
+ * entries up to 512, N/8-1 above. Stored as the scalar S, so every
+ * WDLFFT<T> with the same scalar shares one read-only copy.
+ */
+template <typename S, int32_t N>
+struct wdl_fft_ctwiddle {
+    static constexpr int32_t SIZE = N <= 16 ? 3 : N <= 512 ? N / 4 - 1 : N / 8 - 1;
+    cmplxT<S> d[SIZE];
+    
+    constexpr wdl_fft_ctwiddle() : d()
+    {
+        for (int32_t x = 0; x < SIZE; x ++)
+        {
+            d[x].re = (S) wdl_fft_ccos(2.0 * M_PI * (x + 1) / N);
+            d[x].im = (S) wdl_fft_csin(2.0 * M_PI * (x + 1) / N);
+        }
+    }
+};
+
+/* WDL_fft_permute_tab(N), fftfreq_c built bottom-up in place */
+template <int32_t N>
+struct wdl_fft_cpermute {
+    int32_t p[N];
+    
+    constexpr wdl_fft_cpermute() : p()
+    {
+        int32_t f[N] = { }, n = 0, i = 0;
+        f[N > 1 ? 1 : 0] = N > 1 ? 1 : 0;
+        for (n = 4; n <= N; n *= 2)
+        {
+            // fftfreq_c(i, n/4) == fftfreq_c(i, n/2) / 2, so f[0..n/2-1] is all we need
+            for (i = n / 2; i < 3 * n / 4; i ++) f[i] = 2 * f[i - n / 2] + 1;
+            for (i = 3 * n / 4; i < n; i ++) f[i] = (2 * f[i - 3 * n / 4] - 1) & (n - 1);
+            for (i = 0; i < n / 2; i ++) f[i] *= 2;
+        }
+        p[0] = 0;
+        for (i = 1; i < N; i ++) p[N - f[i]] = i;
+    }
+};
+
+template <typename S, int32_t N> inline constexpr wdl_fft_ctwiddle<S, N> wdl_fft_ctwiddle_tab = wdl_fft_ctwiddle<S, N>();
+template <int32_t N> inline constexpr wdl_fft_cpermute<N> wdl_fft_cpermute_tab = wdl_fft_cpermute<N>();
+
+/*
+ * Same cycle list as fft_make_reorder_table(log2(N)); with tab == 0 it
+ * only returns the length.
+ */
+template <int32_t N>
+constexpr int32_t wdl_fft_creorder_fill(int32_t *tab)
+{
+    const int32_t *p = wdl_fft_cpermute_tab<N>.p;
+    bool flag[N] = { };
+    int32_t x = 0, fx = 0, len = 0;
+    
+    for (x = 0; x < N; x ++)
+    {
+        if (!flag[x] && (fx = p[x]) != x)
+        {
+            flag[x] = true;
+            if (tab) tab[len] = x;
+            len ++;
+            do {
+                flag[fx] = true;
+                if (tab) tab[len] = fx;
+                len ++;
+                fx = p[fx];
+            } while (fx != x);
+            if (tab) tab[len] = 0; // delimit a run
+            len ++;
+        }
+        else flag[x] = true;
+    }
+    if (tab) tab[len] = 0; // doublenull terminated
+    return len + 1;
+}
+
+template <int32_t N>
+struct wdl_fft_creorder {
+    static constexpr int32_t SIZE = wdl_fft_creorder_fill<N>(0);
+    int32_t t[SIZE];
+    
+    constexpr wdl_fft_creorder() : t() { wdl_fft_creorder_fill<N>(t); }
+};
+
+template <int32_t N> inline constexpr wdl_fft_creorder<N> wdl_fft_creorder_tab = wdl_fft_creorder<N>();
+
+#endif
+
+/*
+ * #define WDL_FFT_CONSTEXPR_TABLES (C++17) to use the constexpr tables
+ * above for the runtime transforms too: the twiddles, permutations and
+ * reorder tables are then computed by the compiler and live in read-only
+ * data shared by every process mapping the binary. WDL_fft_init and
+ * InitFFTData become no-ops, DECL_WDLFFT is optional, and nothing needs
+ * to run before the first transform.
+ */
+#if defined(WDL_FFT_CONSTEXPR_TABLES) && __cplusplus < 201703L
+#error WDL_FFT_CONSTEXPR_TABLES needs C++17
+#endif
+
 #define FFT_MINBITLEN           4  // 16 min
 #define FFT_MAXBITLEN           15 // 32768 max
 #define FFT_MINBITLEN_REORDER   (FFT_MINBITLEN-1)
 
 // #define WDL_FFT_NO_PERMUTE
 
+/*
+ * #define WDL_FFT_STATS to count, per stage and per size (log2 bucket),
+ * the calls, timestamp-counter ticks (rdtsc on x86, cntvct on arm64,
+ * nanoseconds elsewhere) and buffer bytes covered. Stages nest: a
+ * real_fft also shows up as an fft of half its size plus a split pass.
+ * Read it with WDLFFT_Stats::global().snapshot(). Without the define the
+ * hooks expand to nothing.
+ */
+#ifdef WDL_FFT_STATS
+
+#include <stdio.h>
+#include <atomic>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+static inline uint64_t wdl_fft_ticks()
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t v;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+enum {
+    WDL_FFT_STAGE_FFT = 0,      // fft, fft<N>
+    WDL_FFT_STAGE_REAL_FFT,     // real_fft, real_fft<N>, whole call
+    WDL_FFT_STAGE_REAL_SPLIT,   // two_for_one_pass inside real_fft
+    WDL_FFT_STAGE_REORDER,      // reorder_buffer
+    WDL_FFT_STAGE_COMPLEXMUL,   // WDL_fft_complexmul, 2, 3 (size bucket of n)
+    WDL_FFT_STAGES
+};
+
+struct WDLFFT_StatsSnapshot {
+    struct entry {
+        uint64_t calls, ticks, max_ticks, bytes;
+    };
+    entry e[WDL_FFT_STAGES][FFT_MAXBITLEN + 1]; // [stage][log2(len)]
+
+    static const char *stage_name(int32_t stage)
+    {
+        static const char *names[WDL_FFT_STAGES] = { "fft", "real_fft", "real_split", "reorder", "complexmul" };
+        return stage >= 0 && stage < WDL_FFT_STAGES ? names[stage] : "?";
+    }
+
+    /* one line per stage and size that saw calls */
+    void print(FILE *fp) const
+    {
+        int32_t st, b;
+        fprintf(fp, "%-11s %6s %12s %14s %10s %10s %14s\n", "stage", "len", "calls", "ticks", "avg", "max", "bytes");
+        for (st = 0; st < WDL_FFT_STAGES; st ++)
+            for (b = 0; b <= FFT_MAXBITLEN; b ++)
+            {
+                const entry &x = e[st][b];
+                if (!x.calls) continue;
+                fprintf(fp, "%-11s %6d %12llu %14llu %10llu %10llu %14llu\n", stage_name(st), 1 << b,
+                        (unsigned long long)x.calls, (unsigned long long)x.ticks,
+                        (unsigned long long)(x.ticks / x.calls), (unsigned long long)x.max_ticks,
+                        (unsigned long long)x.bytes);
+            }
+    }
+};
+
+class WDLFFT_Stats {
+public:
+
+    static WDLFFT_Stats &global()
+    {
+        static WDLFFT_Stats s;
+        return s;
+    }
+
+    void add(int32_t stage, int32_t len, uint64_t ticks, uint64_t bytes)
+    {
+        int32_t b = 0;
+        while (b < FFT_MAXBITLEN && (2 << b) <= len) b ++;
+
+        counter &c = m_c[stage][b];
+        c.calls.fetch_add(1, std::memory_order_relaxed);
+        c.ticks.fetch_add(ticks, std::memory_order_relaxed);
+        c.bytes.fetch_add(bytes, std::memory_order_relaxed);
+        uint64_t m = c.max_ticks.load(std::memory_order_relaxed);
+        while (ticks > m && !c.max_ticks.compare_exchange_weak(m, ticks, std::memory_order_relaxed)) { }
+    }
+
+    /* relaxed copy; counters may be mid-update on other threads */
+    void snapshot(WDLFFT_StatsSnapshot *out) const
+    {
+        int32_t st, b;
+        for (st = 0; st < WDL_FFT_STAGES; st ++)
+            for (b = 0; b <= FFT_MAXBITLEN; b ++)
+            {
+                const counter &c = m_c[st][b];
+                WDLFFT_StatsSnapshot::entry &x = out->e[st][b];
+                x.calls = c.calls.load(std::memory_order_relaxed);
+                x.ticks = c.ticks.load(std::memory_order_relaxed);
+                x.max_ticks = c.max_ticks.load(std::memory_order_relaxed);
+                x.bytes = c.bytes.load(std::memory_order_relaxed);
+            }
+    }
+
+    void reset()
+    {
+        int32_t st, b;
+        for (st = 0; st < WDL_FFT_STAGES; st ++)
+            for (b = 0; b <= FFT_MAXBITLEN; b ++)
+            {
+                counter &c = m_c[st][b];
+                c.calls.store(0, std::memory_order_relaxed);
+                c.ticks.store(0, std::memory_order_relaxed);
+                c.max_ticks.store(0, std::memory_order_relaxed);
+                c.bytes.store(0, std::memory_order_relaxed);
+            }
+    }
+
+private:
+
+    struct counter {
+        std::atomic<uint64_t> calls, ticks, max_ticks, bytes;
+        counter() : calls(0), ticks(0), max_ticks(0), bytes(0) { }
+    };
+    counter m_c[WDL_FFT_STAGES][FFT_MAXBITLEN + 1];
+};
+
+// BEGIN notes the size, END charges len * elem_bytes bytes to it
+#define WDL_FFT_STAT_BEGIN(v, len) const uint64_t v = wdl_fft_ticks(); const int32_t v##_len = (len)
+#define WDL_FFT_STAT_END(v, stage, elem_bytes) WDLFFT_Stats::global().add(stage, v##_len, wdl_fft_ticks() - v, (uint64_t) v##_len * (elem_bytes))
+
+#else
+
+#define WDL_FFT_STAT_BEGIN(v, len)
+#define WDL_FFT_STAT_END(v, stage, elem_bytes)
+
+#endif
+
+/*
+ * #define WDL_FFT_DEBUG to validate every fft, real_fft, reorder_buffer and
+ * WDL_fft_complexmul* call: supported size, WDL_fft_init / InitFFTData
+ * having built the tables it reads, and buffer alignment (alignof(T), or
+ * WDL_FFT_ALIGN with WDL_FFT_ALIGNED). A failed check prints the call
+ * and runs WDL_FFT_DEBUG_FAIL (abort() unless defined). Without the
+ * define the checks expand to nothing; the int32_t status returns
+ * (0 done, -1 nothing done) are there either way.
+ */
+#ifdef WDL_FFT_DEBUG
+
+#ifndef WDL_FFT_DEBUG_FAIL
+#define WDL_FFT_DEBUG_FAIL() abort()
+#endif
+
+#define WDL_FFT_CHECK_CALL(buf, len, fn) debug_check((buf), (len), (fn))
+#define WDL_FFT_CHECK(cond, ...) do { \
+    if (!(cond)) \
+    { \
+        fprintf(stderr, "wdlfft: %s:%d: ", __FILE__, __LINE__); \
+        fprintf(stderr, __VA_ARGS__); \
+        fputc('\n', stderr); \
+        WDL_FFT_DEBUG_FAIL(); \
+    } \
+} while (0)
+
+#else
+
+#define WDL_FFT_CHECK_CALL(buf, len, fn)
+#define WDL_FFT_CHECK(cond, ...) ((void) 0)
+
+#endif
+
 template <typename T>
 class WDLFFT {
 public:
@@ -48,28 +595,99 @@ public:
     static const int S_TAB_SIZE = (2 << FFT_MAXBITLEN) + 24 * (FFT_MAXBITLEN - FFT_MINBITLEN_REORDER + 1);
     static const int IDXPERM_SIZE = 2 << FFT_MAXBITLEN;
     
+    typedef typename wdl_fft_scalar<T>::type scalar_t;
+#ifdef WDL_FFT_CONSTEXPR_TABLES
+    typedef cmplxT<scalar_t> twiddle_t;
+#else
+    typedef cmplxT<T> twiddle_t;
+#endif
+    
+    /* true once WDL_fft_init has built the twiddle and permutation tables */
+    static bool tables_ready()
+    {
+#ifdef WDL_FFT_CONSTEXPR_TABLES
+        return true;
+#else
+        return tabs_built();
+#endif
+    }
+    
+    /*
+     * true if InitFFTData(fftsize) built the reorder_buffer table for
+     * fftsize. Sizes up to 8 share one table, so only the last one
+     * initialized counts.
+     */
+    static bool reorder_table_ready(int32_t fftsize)
+    {
+        if (fftsize < 2 || fftsize > (1 << FFT_MAXBITLEN) || (fftsize & (fftsize - 1))) return false;
+#ifdef WDL_FFT_CONSTEXPR_TABLES
+        return true;
+#else
+        return (reorder_built() >> floorlog2(fftsize)) & 1;
+#endif
+    }
+    
     /*
      * NOTE: Must call this once per C++ template "T" <type> type in your main()
      *       and also DECL_WDLFFT(<type>) to declare globals for that type
+     *       (both unneeded with WDL_FFT_CONSTEXPR_TABLES)
      */
     static void InitFFTData(int fftsize)
     {
+#ifdef WDL_FFT_CONSTEXPR_TABLES
+        (void) fftsize;
+#else
         // fprintf(stderr, "InitFFTData( %d ), x: %d\n", fftsize, x);
         WDL_fft_init();
 
         int n = floorlog2(fftsize);
         fft_make_reorder_table(n, fft_reorder_table_for_bitsize(n));
+        
+        // sizes up to 2^FFT_MINBITLEN_REORDER share s_tab
+        if (n <= FFT_MINBITLEN_REORDER) reorder_built() &= ~((2u << FFT_MINBITLEN_REORDER) - 1);
+        reorder_built() |= 1u << n;
+#endif
+    }
+
+    /* WDL_FFT_ALIGN aligned transform buffer of n complex (2*n real) values */
+    static cmplxT<T> *alloc_buffer(int32_t n)
+    {
+        return (cmplxT<T> *)WDL_fft_aligned_alloc(n * sizeof(cmplxT<T>));
+    }
+
+    static void free_buffer(void *buf)
+    {
+        WDL_fft_aligned_free(buf);
+    }
+    
+    /*
+     * Zeroes every re/im lane of buf[0..n-1] smaller in magnitude than
+     * thresh (default: smallest normal). Meant for state that outlives a
+     * call, like convolution spectra and overlap tails decaying toward
+     * zero, on targets or threads where WDLFFT_DenormalGuard is not an
+     * option.
+     */
+    static void flush_denormals(cmplxT<T> *buf, int32_t n, scalar_t thresh = std::numeric_limits<scalar_t>::min())
+    {
+        scalar_t *p = (scalar_t *)WDL_FFT_ASSUME_ALIGNED(buf);
+        const size_t cnt = (size_t)n * (sizeof(cmplxT<T>) / sizeof(scalar_t));
+        size_t i;
+        for (i = 0; i < cnt; i ++) p[i] = (p[i] < thresh && p[i] > -thresh) ? 0 : p[i];
     }
     
     /* 
      * Expects double input[0..len-1] scaled by 0.5/len, returns
      * cmplxT<T> output[0..len/2-1], for len >= 4 order by
      * WDL_fft_permute(len/2). Note that output[len/2].re is stored in
-     * output[0].im.
+     * output[0].im. Returns 0, or -1 (buf untouched) if len is not a
+     * power of two in 2..32768.
      */
 
-    static void real_fft(T* buf, int32_t len, int32_t isInverse)
+    static int32_t real_fft(T* buf, int32_t len, int32_t isInverse)
     {
+        WDL_FFT_CHECK_CALL(buf, len, "real_fft");
+        WDL_FFT_FTZ_SCOPE;
+        WDL_FFT_STAT_BEGIN(t0, len);
         switch (len)
         {
             case 2: if (!isInverse) r2(buf); else v2(buf); break;
@@ -88,9 +706,121 @@ public:
                 TMP(16384)
                 TMP(32768)
 #undef TMP
+            default: return -1;
         }
+        WDL_FFT_STAT_END(t0, WDL_FFT_STAGE_REAL_FFT, sizeof(T));
+        return 0;
     }
     
+    /*
+     * Two real signals of the same length through one complex fft: leaves
+     * x and y exactly as real_fft(x, len, isInverse) and
+     * real_fft(y, len, isInverse) would (same packing, order and gain).
+     * Forward runs fft on z = x + i*y and splits the spectra with
+     *
+     *   2*X[k] = Z[k] + conj(Z[len-k]),  2*Y[k] = -i*(Z[k] - conj(Z[len-k]))
+     *
+     * inverse rebuilds Z = X + i*Y and takes x, y from re and im. work
+     * must hold len elements. Returns 0, or -1 if len is not a power of
+     * two in 2..32768.
+     *
+     * NOTE: real_fft already runs a len/2 complex fft, so this saves
+     *       call and pass overhead (~5-20% up to about 4096 points), not
+     *       flops; past L1/L2 the extra interleave pass makes it slower
+     *       than two real_fft calls.
+     */
+    static int32_t real_fft2(T *x, T *y, int32_t len, int32_t isInverse, cmplxT<T> *work)
+    {
+        WDL_FFT_CHECK_CALL(x, len, "real_fft2");
+        WDL_FFT_CHECK_CALL(y, len, "real_fft2");
+        if (len < 2 || len > (1 << FFT_MAXBITLEN) || (len & (len - 1))) return -1;
+        
+        WDL_FFT_FTZ_SCOPE;
+        WDL_FFT_STAT_BEGIN(t0, len);
+        cmplxT<T> *X = (cmplxT<T> *)x, *Y = (cmplxT<T> *)y;
+        const int32_t half = len >> 1;
+        const int32_t *pz = WDL_fft_permute_tab(len);
+        int32_t k;
+        
+        if (!isInverse)
+        {
+            for (k = 0; k < len; k ++)
+            {
+                work[k].re = x[k];
+                work[k].im = y[k];
+            }
+            fft(work, len, 0);
+            
+            WDL_FFT_STAT_BEGIN(t1, len);
+            const cmplxT<T> z0 = work[0], zh = work[pz[half]];
+            X[0].re = z0.re + z0.re;
+            X[0].im = zh.re + zh.re;
+            Y[0].re = z0.im + z0.im;
+            Y[0].im = zh.im + zh.im;
+            if (half > 1)
+            {
+                const int32_t *ph = WDL_fft_permute_tab(half);
+                for (k = 1; k < half; k ++)
+                {
+                    const cmplxT<T> a = work[pz[k]], b = work[pz[len - k]];
+                    const int32_t o = ph[k];
+                    X[o].re = a.re + b.re;
+                    X[o].im = a.im - b.im;
+                    Y[o].re = a.im + b.im;
+                    Y[o].im = b.re - a.re;
+                }
+            }
+            WDL_FFT_STAT_END(t1, WDL_FFT_STAGE_REAL_SPLIT, 2 * sizeof(T));
+        } else
+        {
+            WDL_FFT_STAT_BEGIN(t1, len);
+            work[0].re = X[0].re;
+            work[0].im = Y[0].re;
+            work[pz[half]].re = X[0].im;
+            work[pz[half]].im = Y[0].im;
+            if (half > 1)
+            {
+                const int32_t *ph = WDL_fft_permute_tab(half);
+                for (k = 1; k < half; k ++)
+                {
+                    const int32_t o = ph[k];
+                    const cmplxT<T> a = X[o], b = Y[o];
+                    cmplxT<T> &zk = work[pz[k]], &zn = work[pz[len - k]];
+                    zk.re = a.re - b.im;
+                    zk.im = a.im + b.re;
+                    zn.re = a.re + b.im;
+                    zn.im = b.re - a.im;
+                }
+            }
+            WDL_FFT_STAT_END(t1, WDL_FFT_STAGE_REAL_SPLIT, 2 * sizeof(T));
+            
+            fft(work, len, 1);
+            for (k = 0; k < len; k ++)
+            {
+                x[k] = work[k].re;
+                y[k] = work[k].im;
+            }
+        }
+        WDL_FFT_STAT_END(t0, WDL_FFT_STAGE_REAL_FFT, 2 * sizeof(T));
+        return 0;
+    }
+    
+    /* same, with the work buffer taken from the thread's WDLFFT_Arena */
+    static int32_t real_fft2(T *x, T *y, int32_t len, int32_t isInverse)
+    {
+        WDLFFT_Scratch scratch;
+        return real_fft2(x, y, len, isInverse, scratch.get< cmplxT<T> >(len));
+    }
+    
+#ifdef WDL_FFT_CONSTEXPR_TABLES
+    
+#define TMP(x) static constexpr const twiddle_t *d##x = wdl_fft_ctwiddle_tab<scalar_t, x>.d;
+    TMP(16) TMP(32) TMP(64) TMP(128) TMP(256) TMP(512)
+    TMP(1024) TMP(2048) TMP(4096) TMP(8192) TMP(16384) TMP(32768)
+#undef TMP
+    
+#else
+    
     static cmplxT<T> d16[3];
     static cmplxT<T> d32[7];
     static cmplxT<T> d64[15];
@@ -107,9 +837,14 @@ public:
     static int32_t s_tab[S_TAB_SIZE]; // big 256kb table, ugh
     static int32_t _idxperm[IDXPERM_SIZE];
     
-    #define sqrthalf (d16[1].re)
+#endif
+    
+    #define sqrthalf ((T)M_SQRT1_2)
         
     #define VOL *(volatile T *)&
+    
+    // twiddles may be stored as T or as its scalar (compile-time tables)
+    #define VOLW(x) (*(volatile typename std::remove_reference<decltype(x)>::type *)&(x))
         
     #define TRANSFORM(a0,a1,a2,a3,wre,wim) { \
     t6 = a2.re; \
@@ -215,10 +950,10 @@ public:
     }
         
     #define UNTRANSFORM(a0,a1,a2,a3,wre,wim) { \
-    t6 = VOL wre; \
+    t6 = VOLW(wre); \
     t1 = VOL a2.re; \
     t1 *= t6; \
-    t8 = VOL wim; \
+    t8 = VOLW(wim); \
     t3 = VOL a2.im; \
     t3 *= t8; \
     t2 = VOL a2.im; \
@@ -317,11 +1052,21 @@ public:
     a1.im = t4; \
     }
     
-    void reorder_buffer(int sz, T *buf, int isInverse)
+    /*
+     * Moves fft output from WDL_fft_permute(sz) order to natural order, or
+     * back with isInverse. Needs InitFFTData(sz). Returns -1 (and does
+     * nothing) if sz is not a power of two in 2..32768.
+     */
+    int32_t reorder_buffer(int sz, T *buf, int isInverse)
     {
+        WDL_FFT_CHECK_CALL(buf, sz, "reorder_buffer");
+        WDL_FFT_CHECK(reorder_table_ready(sz), "reorder_buffer(%d): table not built, call InitFFTData(%d) (sizes up to 8 share one)", sz, sz);
+        if (sz < 2 || sz > (1 << FFT_MAXBITLEN) || (sz & (sz - 1))) return -1;
+        
         cmplxT<T> *data = (cmplxT<T>*)buf;
         int bitsz = floorlog2(sz);
         const int32_t *tab = fft_reorder_table_for_bitsize(bitsz);
+        WDL_FFT_STAT_BEGIN(t0, sz);
         if (isInverse)
         {
             while (*tab)
@@ -356,6 +1101,8 @@ public:
                 data[lidx] = sta;
             }
         }
+        WDL_FFT_STAT_END(t0, WDL_FFT_STAGE_REORDER, sizeof(cmplxT<T>));
+        return 0;
     }
     
     static void c2(cmplxT<T> *a)
@@ -500,13 +1247,15 @@ public:
     }
     
     /* a[0...8n-1], w[0...2n-2]; n >= 2 */
-    static void cpass(cmplxT<T> *a,const cmplxT<T> *w,uint32_t n)
+    template <typename W>
+    static void cpass(cmplxT<T> *a,const W *w,uint32_t n)
     {
         T t1, t2, t3, t4, t5, t6, t7, t8;
         cmplxT<T> *a1;
         cmplxT<T> *a2;
         cmplxT<T> *a3;
         
+        a = WDL_FFT_ASSUME_ALIGNED(a);
         a2 = a + 4 * n;
         a1 = a + 2 * n;
         a3 = a2 + 2 * n;
@@ -568,7 +1317,8 @@ public:
     }
     
     /* a[0...8n-1], w[0...n-2]; n even, n >= 4 */
-    static void cpassbig(cmplxT<T> *a,const cmplxT<T> *w,uint32_t n)
+    template <typename W>
+    static void cpassbig(cmplxT<T> *a,const W *w,uint32_t n)
     {
         T t1, t2, t3, t4, t5, t6, t7, t8;
         cmplxT<T> *a1;
@@ -576,6 +1326,7 @@ public:
         cmplxT<T> *a3;
         uint32_t k;
         
+        a = WDL_FFT_ASSUME_ALIGNED(a);
         a2 = a + 4 * n;
         a1 = a + 2 * n;
         a3 = a2 + 2 * n;
@@ -667,12 +1418,17 @@ public:
     }
     
     
-    /* n even, n > 0 */
-    void WDL_fft_complexmul(cmplxT<T> *a,cmplxT<T> *b,int32_t n)
+    /* n even; returns -1 (and does nothing) for odd n */
+    int32_t WDL_fft_complexmul(cmplxT<T> *a,cmplxT<T> *b,int32_t n)
     {
         T t1, t2, t3, t4, t5, t6, t7, t8;
-        if (n<2 || (n&1)) return;
+        WDL_FFT_CHECK(n >= 0 && !(n & 1), "%s: n = %d must be even", "WDL_fft_complexmul", n);
+        if (n<2 || (n&1)) return n ? -1 : 0;
+        a = WDL_FFT_ASSUME_ALIGNED(a);
+        b = WDL_FFT_ASSUME_ALIGNED(b);
         
+        WDL_FFT_FTZ_SCOPE;
+        WDL_FFT_STAT_BEGIN(t0, n);
         do {
             t1 = a[0].re * b[0].re;
             t2 = a[0].im * b[0].im;
@@ -693,13 +1449,21 @@ public:
             a += 2;
             b += 2;
         } while (n -= 2);
+        WDL_FFT_STAT_END(t0, WDL_FFT_STAGE_COMPLEXMUL, 2 * sizeof(cmplxT<T>));
+        return 0;
     }
     
-    void WDL_fft_complexmul2(cmplxT<T> *c, cmplxT<T> *a, cmplxT<T> *b, int32_t n)
+    int32_t WDL_fft_complexmul2(cmplxT<T> *c, cmplxT<T> *a, cmplxT<T> *b, int32_t n)
     {
         T t1, t2, t3, t4, t5, t6, t7, t8;
-        if (n<2 || (n&1)) return;
-        
+        WDL_FFT_CHECK(n >= 0 && !(n & 1), "%s: n = %d must be even", "WDL_fft_complexmul2", n);
+        if (n<2 || (n&1)) return n ? -1 : 0;
+        a = WDL_FFT_ASSUME_ALIGNED(a);
+        b = WDL_FFT_ASSUME_ALIGNED(b);
+        c = WDL_FFT_ASSUME_ALIGNED(c);
+        
+        WDL_FFT_FTZ_SCOPE;
+        WDL_FFT_STAT_BEGIN(t0, n);
         do {
             t1 = a[0].re * b[0].re;
             t2 = a[0].im * b[0].im;
@@ -721,12 +1485,20 @@ public:
             b += 2;
             c += 2;
         } while (n -= 2);
+        WDL_FFT_STAT_END(t0, WDL_FFT_STAGE_COMPLEXMUL, 3 * sizeof(cmplxT<T>));
+        return 0;
     }
-    void WDL_fft_complexmul3(cmplxT<T> *c, cmplxT<T> *a, cmplxT<T> *b, int32_t n)
+    int32_t WDL_fft_complexmul3(cmplxT<T> *c, cmplxT<T> *a, cmplxT<T> *b, int32_t n)
     {
         T t1, t2, t3, t4, t5, t6, t7, t8;
-        if (n<2 || (n&1)) return;
-        
+        WDL_FFT_CHECK(n >= 0 && !(n & 1), "%s: n = %d must be even", "WDL_fft_complexmul3", n);
+        if (n<2 || (n&1)) return n ? -1 : 0;
+        a = WDL_FFT_ASSUME_ALIGNED(a);
+        b = WDL_FFT_ASSUME_ALIGNED(b);
+        c = WDL_FFT_ASSUME_ALIGNED(c);
+        
+        WDL_FFT_FTZ_SCOPE;
+        WDL_FFT_STAT_BEGIN(t0, n);
         do {
             t1 = a[0].re * b[0].re;
             t2 = a[0].im * b[0].im;
@@ -748,6 +1520,8 @@ public:
             b += 2;
             c += 2;
         } while (n -= 2);
+        WDL_FFT_STAT_END(t0, WDL_FFT_STAGE_COMPLEXMUL, 3 * sizeof(cmplxT<T>));
+        return 0;
     }
     
     static inline void u4(cmplxT<T> *a)
@@ -883,13 +1657,15 @@ public:
     }
     
     /* a[0...8n-1], w[0...2n-2] */
-    static void upass(cmplxT<T> *a,const cmplxT<T> *w,uint32_t n)
+    template <typename W>
+    static void upass(cmplxT<T> *a,const W *w,uint32_t n)
     {
         T t1, t2, t3, t4, t5, t6, t7, t8;
         cmplxT<T> *a1;
         cmplxT<T> *a2;
         cmplxT<T> *a3;
         
+        a = WDL_FFT_ASSUME_ALIGNED(a);
         a2 = a + 4 * n;
         a1 = a + 2 * n;
         a3 = a2 + 2 * n;
@@ -952,7 +1728,8 @@ public:
     
     
     /* a[0...8n-1], w[0...n-2]; n even, n >= 4 */
-    static void upassbig(cmplxT<T> *a,const cmplxT<T> *w,uint32_t n)
+    template <typename W>
+    static void upassbig(cmplxT<T> *a,const W *w,uint32_t n)
     {
         T t1, t2, t3, t4, t5, t6, t7, t8;
         cmplxT<T> *a1;
@@ -960,6 +1737,7 @@ public:
         cmplxT<T> *a3;
         uint32_t k;
         
+        a = WDL_FFT_ASSUME_ALIGNED(a);
         a2 = a + 4 * n;
         a1 = a + 2 * n;
         a3 = a2 + 2 * n;
@@ -1092,6 +1870,27 @@ public:
         return ((fftfreq_c(i,m) << 2) - 1) & (n - 1);
     }
     
+#ifdef WDL_FFT_CONSTEXPR_TABLES
+    
+    static __inline const int32_t *WDL_fft_permute_tab(int32_t fftsize)
+    {
+        switch (fftsize)
+        {
+#define TMP(x) case x: return wdl_fft_cpermute_tab<x>.p;
+            TMP(4) TMP(8) TMP(16) TMP(32) TMP(64) TMP(128) TMP(256)
+            TMP(512) TMP(1024) TMP(2048) TMP(4096) TMP(8192) TMP(16384) TMP(32768)
+#undef TMP
+        }
+        return wdl_fft_cpermute_tab<2>.p;
+    }
+    
+    static __inline int32_t WDL_fft_permute(int32_t fftsize, int32_t idx)
+    {
+        return WDL_fft_permute_tab(fftsize)[idx];
+    }
+    
+#else
+    
     static void idx_perm_calc(int32_t offs, int32_t n)
     {
         int32_t i, j;
@@ -1112,15 +1911,21 @@ public:
         return &_idxperm[fftsize - 2];
     }
     
+#endif
+    
     
 #endif
     
     
     /* Expects cmplxT<T> input[0..len-1] scaled by 1.0/len, returns
-    cmplxT<T> output[0..len-1] order by WDL_fft_permute(len). */
+    cmplxT<T> output[0..len-1] order by WDL_fft_permute(len). Returns 0,
+    or -1 (buf untouched) if len is not a power of two in 2..32768. */
 
-    static void fft(cmplxT<T> *buf, int32_t len, int32_t isInverse)
+    static int32_t fft(cmplxT<T> *buf, int32_t len, int32_t isInverse)
     {
+        WDL_FFT_CHECK_CALL(buf, len, "fft");
+        WDL_FFT_FTZ_SCOPE;
+        WDL_FFT_STAT_BEGIN(t0, len);
         switch (len)
         {
             case 2: c2(buf); break;
@@ -1140,9 +1945,122 @@ public:
                 TMP(16384)
                 TMP(32768)
 #undef TMP
+            default: return -1;
         }
+        WDL_FFT_STAT_END(t0, WDL_FFT_STAGE_FFT, sizeof(cmplxT<T>));
+        return 0;
     }
     
+#if __cplusplus >= 201703L
+    
+    /*
+     * Compile-time sized transforms, N = 2..32768. Same input, output,
+     * scaling and permutation as fft(buf, N, isInverse) and
+     * real_fft(buf, N, isInverse), but the recursion is resolved at compile
+     * time (so small sizes inline completely and every pass has a constant
+     * trip count) and the twiddle and permutation tables are constexpr.
+     * They need neither InitFFTData nor DECL_WDLFFT.
+     */
+    
+    template <int32_t N>
+    static void fft(cmplxT<T> *buf, int32_t isInverse)
+    {
+        static_assert(N >= 2 && N <= (1 << FFT_MAXBITLEN) && !(N & (N - 1)), "fft<N>: N must be 2^k, 2..32768");
+        WDL_FFT_FTZ_SCOPE;
+        WDL_FFT_STAT_BEGIN(t0, N);
+        if (!isInverse) cfixed<N>(buf);
+        else ufixed<N>(buf);
+        WDL_FFT_STAT_END(t0, WDL_FFT_STAGE_FFT, sizeof(cmplxT<T>));
+    }
+    
+    template <int32_t N>
+    static void real_fft(T *buf, int32_t isInverse)
+    {
+        static_assert(N >= 2 && N <= (1 << FFT_MAXBITLEN) && !(N & (N - 1)), "real_fft<N>: N must be 2^k, 2..32768");
+        WDL_FFT_FTZ_SCOPE;
+        WDL_FFT_STAT_BEGIN(t0, N);
+        if constexpr (N == 2)
+        {
+            if (!isInverse) r2(buf);
+            else v2(buf);
+        } else
+        {
+            if (!isInverse)
+            {
+                fft<N / 2>((cmplxT<T>*)buf, 0);
+                r2(buf);
+            } else
+            {
+                v2(buf);
+            }
+            WDL_FFT_STAT_BEGIN(t1, N);
+            two_for_one_pass(buf, wdl_fft_ctwiddle_tab<scalar_t, N>.d, wdl_fft_cpermute_tab<N / 2>.p, N, isInverse);
+            WDL_FFT_STAT_END(t1, WDL_FFT_STAGE_REAL_SPLIT, sizeof(T));
+            if (isInverse) fft<N / 2>((cmplxT<T>*)buf, 1);
+        }
+        WDL_FFT_STAT_END(t0, WDL_FFT_STAGE_REAL_FFT, sizeof(T));
+    }
+    
+    template <int32_t N>
+    static void cfixed(cmplxT<T> *a)
+    {
+        if constexpr (N == 2) c2(a);
+        else if constexpr (N == 4) c4(a);
+        else if constexpr (N == 8) c8(a);
+        else if constexpr (N == 16)
+        {
+            T t1, t2, t3, t4, t5, t6, t7, t8;
+            constexpr const cmplxT<scalar_t> *d = wdl_fft_ctwiddle_tab<scalar_t, 16>.d;
+            
+            TRANSFORMZERO(a[0],a[4],a[8],a[12]);
+            TRANSFORM(a[1],a[5],a[9],a[13],d[0].re,d[0].im);
+            TRANSFORMHALF(a[2],a[6],a[10],a[14]);
+            TRANSFORM(a[3],a[7],a[11],a[15],d[0].im,d[0].re);
+            c4(a + 8);
+            c4(a + 12);
+            
+            c8(a);
+        } else
+        {
+            if constexpr (N <= 512) cpass(a, wdl_fft_ctwiddle_tab<scalar_t, N>.d, N / 8);
+            else cpassbig(a, wdl_fft_ctwiddle_tab<scalar_t, N>.d, N / 8);
+            cfixed<N / 4>(a + N / 2 + N / 4);
+            cfixed<N / 4>(a + N / 2);
+            cfixed<N / 2>(a);
+        }
+    }
+    
+    template <int32_t N>
+    static void ufixed(cmplxT<T> *a)
+    {
+        if constexpr (N == 2) c2(a);
+        else if constexpr (N == 4) u4(a);
+        else if constexpr (N == 8) u8(a);
+        else if constexpr (N == 16)
+        {
+            T t1, t2, t3, t4, t5, t6, t7, t8;
+            constexpr const cmplxT<scalar_t> *d = wdl_fft_ctwiddle_tab<scalar_t, 16>.d;
+            
+            u8(a);
+            u4(a + 8);
+            u4(a + 12);
+            
+            UNTRANSFORMZERO(a[0],a[4],a[8],a[12]);
+            UNTRANSFORMHALF(a[2],a[6],a[10],a[14]);
+            UNTRANSFORM(a[1],a[5],a[9],a[13],d[0].re,d[0].im);
+            UNTRANSFORM(a[3],a[7],a[11],a[15],d[0].im,d[0].re);
+        } else
+        {
+            ufixed<N / 2>(a);
+            ufixed<N / 4>(a + N / 2);
+            ufixed<N / 4>(a + N / 2 + N / 4);
+            if constexpr (N <= 512) upass(a, wdl_fft_ctwiddle_tab<scalar_t, N>.d, N / 8);
+            else upassbig(a, wdl_fft_ctwiddle_tab<scalar_t, N>.d, N / 8);
+        }
+    }
+    
+#endif
+    
     static inline void r2(T *a)
     {
         T t1, t2;
@@ -1163,14 +2081,9 @@ public:
         a[1] = t2;
     }
     
-    static void two_for_one(T* buf, const cmplxT<T> *d, int32_t len, int32_t isInverse)
+    static void two_for_one(T* buf, const twiddle_t *d, int32_t len, int32_t isInverse)
     {
-        const uint32_t half = (uint32_t)len >> 1, quart = half >> 1, eighth = quart >> 1;
-        const int32_t *permute = WDL_fft_permute_tab(half);
-        uint32_t i, j;
-        
-        cmplxT<T> *p, *q, tw, sum, diff;
-        T tw1, tw2;
+        const int32_t half = len >> 1;
         
         if (!isInverse)
         {
@@ -1181,6 +2094,23 @@ public:
             v2(buf);
         }
         
+        WDL_FFT_STAT_BEGIN(t0, len);
+        two_for_one_pass(buf, d, WDL_fft_permute_tab(half), len, isInverse);
+        WDL_FFT_STAT_END(t0, WDL_FFT_STAGE_REAL_SPLIT, sizeof(T));
+        
+        if (isInverse) fft((cmplxT<T>*)buf, half, isInverse);
+    }
+    
+    /* the real/complex split between the half-size fft and the real spectrum */
+    template <typename W>
+    static void two_for_one_pass(T* buf, const W *d, const int32_t *permute, int32_t len, int32_t isInverse)
+    {
+        const uint32_t half = (uint32_t)len >> 1, quart = half >> 1, eighth = quart >> 1;
+        uint32_t i, j;
+        
+        cmplxT<T> *p, *q, tw, sum, diff;
+        T tw1, tw2;
+        
         /* Source: http://www.katjaas.nl/realFFT/realFFT2.html */
         
         for (i = 1; i < quart; ++i)
@@ -1194,11 +2124,13 @@ public:
             if (i < eighth)
             {
                 j = i - 1;
-                tw = d[j];
+                tw.re = d[j].re;
+                tw.im = d[j].im;
             } else if (i > eighth)
             {
                 j = quart - i - 1;
-                tw = d[j];
+                tw.re = d[j].im;
+                tw.im = d[j].re;
             } else
             {
                 tw.re = tw.im = sqrthalf;
@@ -1223,10 +2155,29 @@ public:
         p = &((cmplxT<T>*)buf)[permute[i]];
         p->re *=  2;
         p->im *= -2;
-        
-        if (isInverse) fft((cmplxT<T>*)buf, half, isInverse);
     }
     
+#ifdef WDL_FFT_CONSTEXPR_TABLES
+    
+    static const int32_t *fft_reorder_table_for_size(int32_t fftsize)
+    {
+        return fft_reorder_table_for_bitsize(floorlog2(fftsize));
+    }
+    
+    static const int32_t *fft_reorder_table_for_bitsize(int32_t bitsz)
+    {
+        switch (bitsz)
+        {
+#define TMP(b) case b: return wdl_fft_creorder_tab<1 << b>.t;
+            TMP(2) TMP(3) TMP(4) TMP(5) TMP(6) TMP(7) TMP(8)
+            TMP(9) TMP(10) TMP(11) TMP(12) TMP(13) TMP(14) TMP(15)
+#undef TMP
+        }
+        return wdl_fft_creorder_tab<2>.t;
+    }
+    
+#else
+    
     static int32_t *fft_reorder_table_for_size(int32_t fftsize)
     {
         int bitsz = floorlog2(fftsize);
@@ -1242,10 +2193,13 @@ public:
         return s_tab + (1 << bitsz) + (bitsz - FFT_MINBITLEN_REORDER) * 24;
     }
     
+#endif
+    
     static void fft_make_reorder_table(int32_t bitsz, int32_t *tab)
     {
         const int32_t fft_sz = 1 << bitsz;
-        uint8_t flag[1 << FFT_MAXBITLEN];
+        WDLFFT_Scratch scratch;
+        uint8_t *flag = scratch.get<uint8_t>(fft_sz);
         int32_t x;
         memset(flag, 0, fft_sz);
         
@@ -1269,9 +2223,40 @@ public:
         *tab++ = 0; // doublenull terminated
     }
     
+#ifndef WDL_FFT_CONSTEXPR_TABLES
+    static bool &tabs_built()
+    {
+        static bool built = false;
+        return built;
+    }
+    
+    static uint32_t &reorder_built() // bit n: table for 2^n
+    {
+        static uint32_t mask = 0;
+        return mask;
+    }
+#endif
+    
+#ifdef WDL_FFT_DEBUG
+    static void debug_check(const void *buf, int32_t len, const char *fn)
+    {
+#ifdef WDL_FFT_ALIGNED
+        const uintptr_t align = WDL_FFT_ALIGN;
+#else
+        const uintptr_t align = alignof(T);
+#endif
+        WDL_FFT_CHECK(buf, "%s(%d): null buffer", fn, len);
+        WDL_FFT_CHECK(len >= 2 && len <= (1 << FFT_MAXBITLEN) && !(len & (len - 1)),
+                      "%s(%d): len must be a power of two, 2..32768", fn, len);
+        WDL_FFT_CHECK(tables_ready(), "%s(%d): WDL_fft_init() has not run for this T", fn, len);
+        WDL_FFT_CHECK(!((uintptr_t) buf & (align - 1)), "%s(%d): buffer %p is not %d-byte aligned", fn, len, buf, (int) align);
+    }
+#endif
+    
     static void WDL_fft_init()
     {
-        static bool ffttabinit = false;
+#ifndef WDL_FFT_CONSTEXPR_TABLES
+        bool &ffttabinit = tabs_built();
         
         if (!ffttabinit)
         {
@@ -1304,12 +2289,16 @@ public:
             }
 #endif
         }
+#endif
     }
     
 };
 
 
 
+#ifdef WDL_FFT_CONSTEXPR_TABLES
+#define DECL_WDLFFT(TYPE)
+#else
 #define DECL_WDLFFT(TYPE) \
 template <typename T> int32_t WDLFFT<T>::s_tab[WDLFFT<T>::S_TAB_SIZE]; \
 template <typename T> int32_t WDLFFT<T>::_idxperm[WDLFFT<T>::IDXPERM_SIZE]; \
@@ -1325,6 +2314,4 @@ template <typename T> cmplxT<T> WDLFFT<T>::d4096[511]; \
 template <typename T> cmplxT<T> WDLFFT<T>::d8192[1023]; \
 template <typename T> cmplxT<T> WDLFFT<T>::d16384[2047]; \
 template <typename T> cmplxT<T> WDLFFT<T>::d32768[4095];
-
-
-
+#endif
@@ -0,0 +1,216 @@
+/*
+ **  Exact integer convolution / big-number multiply on top of WDLFFT
+ **
+ **  C++ wrapper (C)2024 DEMOS
+ **  GITHUB: https://github.com/mewza or Email: subband@protonmail.com
+ **  LICENSE: same as wdlfft.h
+ **
+ **  A double FFT convolution is exact only while every output, plus the
+ **  transform's rounding error, stays well inside the 53-bit mantissa.
+ **  With 16-bit coefficients the outputs reach n * 2^32 and the error
+ **  passes 0.5 around 2^15..2^16 points. WDLFFT_BigMul splits every
+ **  coefficient into three s-bit pieces, s = ceil(bits/3), so
+ **
+ **    a = a0 + a1*2^s + a2*2^2s,  b likewise,
+ **    a*b = c0 + c1*2^s + c2*2^2s + c3*2^3s + c4*2^4s,
+ **    c0 = a0*b0, c1 = a0*b1 + a1*b0, ... c4 = a2*b2
+ **
+ **  and each c_j is at most 3 * min(na, nb) * (2^s - 1)^2: 2^45 for
+ **  16-bit limbs even at 2^30 points. The six real piece sequences go
+ **  through three complex FFTs (two real signals per transform, split
+ **  with Z[k] +- conj(Z[N-k])). The nine products are formed per bin
+ **  pair (k, N-k) in place, and the five c_j come back through three
+ **  inverse FFTs, packed as c0 + i*c1, c2 + i*c3, c4. That is six
+ **  complex N-point transforms in all, N the power of two >= na + nb - 1.
+ **
+ **  Every output is rounded to the nearest integer, and the largest
+ **  distance to it is checked: above 0.25 (or if a piece would round
+ **  to a negative value) the call returns false and the output is not
+ **  valid. N up to 32768 runs WDLFFT<double>::fft and works in permuted
+ **  order. Larger N, up to 2^30, runs the four-step WDLFFT_OOC<double>::fft
+ **  on memory buffers: one more buffer, natural order, link with -pthread.
+ **  Memory is 4 * N * 16 bytes at most.
+ */
+
+#pragma once
+
+#include "wdlfft_ooc.h"
+
+class WDLFFT_BigMul {
+public:
+
+    enum { MAX_LOG2 = 2 * FFT_MAXBITLEN };
+
+    /*
+     * c[0..na+nb-2] = sum a[i] * b[k-i], every a[i], b[i] < 2^bits, bits
+     * 1..32. Fails if an output could overflow uint64 (2*bits +
+     * log2(min(na, nb)) > 64), if a piece sum could leave the exact range
+     * of double, if na + nb - 1 > 2^30, if the buffers cannot be
+     * allocated (c is then untouched), or if the rounding check fails.
+     * max_err, if given, gets the largest distance to an integer seen.
+     */
+    static bool convolve(const uint32_t *a, int64_t na, const uint32_t *b, int64_t nb, uint64_t *c, int32_t bits,
+                         double *max_err = 0)
+    {
+        if (na < 1 || nb < 1 || bits < 1 || bits > 32) return false;
+        if (log2((double)(na < nb ? na : nb)) + 2.0 * bits > 64.0) return false;
+        return run(a, na, b, nb, bits, max_err, [c](int64_t k, uint64_t v) { c[k] = v; });
+    }
+
+    /*
+     * Big integer product: a and b little-endian 16-bit limbs, c gets all
+     * na + nb limbs (the top one may be 0). c must not overlap a or b.
+     */
+    static bool multiply(const uint16_t *a, int64_t na, const uint16_t *b, int64_t nb, uint16_t *c, double *max_err = 0)
+    {
+        uint64_t carry = 0;
+        if (na < 1 || nb < 1) return false;
+
+        // outputs arrive in order, each < 2^62 even at 2^30 limbs, so the carry stays small
+        const bool ok = run(a, na, b, nb, 16, max_err, [c, &carry](int64_t k, uint64_t v)
+        {
+            carry += v;
+            c[k] = (uint16_t) carry;
+            carry >>= 16;
+        });
+        c[na + nb - 1] = (uint16_t) carry;
+        return ok;
+    }
+
+private:
+
+    /* piece sums must stay below this so the rounding check means something */
+    static double exact_limit() { return 4503599627370496.0; }     // 2^52
+
+    /* the transform: permuted WDLFFT up to 32768 points, natural-order four-step above */
+    static void xfft(cmplxT<double> *&z, cmplxT<double> *&tmp, int64_t n, int32_t isInverse)
+    {
+        if (n <= (1 << FFT_MAXBITLEN))
+        {
+            WDLFFT<double>::fft(z, (int32_t) n, isInverse);
+        } else
+        {
+            cmplxT<double> *t = z;
+            WDLFFT_OOC<double>::fft(z, tmp, n, isInverse);
+            z = tmp;
+            tmp = t;
+        }
+    }
+
+    template <typename L, typename E>
+    static bool run(const L *a, int64_t na, const L *b, int64_t nb, int32_t bits, double *max_err, const E &emit)
+    {
+        const int32_t s = (bits + 2) / 3;
+        const uint64_t mask = ((uint64_t) 1 << s) - 1;
+        const int64_t nc = na + nb - 1, m = na < nb ? na : nb;
+        int64_t n = 16, k;
+        int32_t j;
+
+        if (max_err) *max_err = 0;
+        while (n < nc) n <<= 1;
+        if (n > ((int64_t) 1 << MAX_LOG2)) return false;
+        if (3.0 * (double) m * (double) mask * (double) mask > exact_limit()) return false;
+
+        WDLFFT<double>::WDL_fft_init();
+        const bool direct = n <= (1 << FFT_MAXBITLEN);
+        const int32_t *perm = direct ? WDLFFT<double>::WDL_fft_permute_tab((int32_t) n) : 0;
+
+        cmplxT<double> *z[3], *tmp = 0;
+        bool got = true;
+        for (j = 0; j < 3; j ++)
+        {
+            z[j] = (cmplxT<double> *) WDL_fft_aligned_alloc(n * sizeof(cmplxT<double>));
+            if (z[j]) memset(z[j], 0, n * sizeof(cmplxT<double>));
+            else got = false;
+        }
+        if (!direct && !(tmp = (cmplxT<double> *) WDL_fft_aligned_alloc(n * sizeof(cmplxT<double>)))) got = false;
+        if (!got)
+        {
+            for (j = 0; j < 3; j ++) WDL_fft_aligned_free(z[j]);
+            WDL_fft_aligned_free(tmp);
+            return false;
+        }
+
+        // z0 = a0 + i*a1, z1 = a2 + i*b0, z2 = b1 + i*b2
+        for (k = 0; k < na; k ++)
+        {
+            const uint64_t v = a[k];
+            z[0][k].re = (double)(v & mask);
+            z[0][k].im = (double)((v >> s) & mask);
+            z[1][k].re = (double)(v >> 2 * s);
+        }
+        for (k = 0; k < nb; k ++)
+        {
+            const uint64_t v = b[k];
+            z[1][k].im = (double)(v & mask);
+            z[2][k].re = (double)((v >> s) & mask);
+            z[2][k].im = (double)(v >> 2 * s);
+        }
+        for (j = 0; j < 3; j ++) xfft(z[j], tmp, n, 0);
+
+        // bins k and n-k together: unpack the six spectra, form c0..c4, repack in place
+        for (k = 0; k <= n / 2; k ++)
+        {
+            const int64_t p = direct ? perm[k] : k, q = direct ? perm[(n - k) & (n - 1)] : (n - k) & (n - 1);
+            cmplxT<double> x[6], y[6];     // y[5] stays 0: c4 has no odd partner
+
+            for (j = 0; j < 3; j ++)
+            {
+                const cmplxT<double> u = z[j][p], v = z[j][q];
+                // X = (u + conj v) / 2, Y = (u - conj v) / 2i
+                x[2 * j].re = 0.5 * (u.re + v.re);
+                x[2 * j].im = 0.5 * (u.im - v.im);
+                x[2 * j + 1].re = 0.5 * (u.im + v.im);
+                x[2 * j + 1].im = -0.5 * (u.re - v.re);
+            }
+            // x: a0 a1 a2 b0 b1 b2
+            const cmplxT<double> *pa = x, *pb = x + 3;
+            for (j = 0; j < 6; j ++) y[j].re = y[j].im = 0;
+            for (j = 0; j < 9; j ++)
+            {
+                const cmplxT<double> &u = pa[j / 3], &v = pb[j % 3];
+                cmplxT<double> &d = y[j / 3 + j % 3];
+                d.re += u.re * v.re - u.im * v.im;
+                d.im += u.re * v.im + u.im * v.re;
+            }
+
+            // bin k gets c_even + i*c_odd; bin n-k the same from the conjugates
+            for (j = 0; j < 3; j ++)
+            {
+                const cmplxT<double> e = y[2 * j], o = y[2 * j + 1];
+                cmplxT<double> &dk = z[j][p], &dq = z[j][q];
+                dk.re = e.re - o.im;
+                dk.im = e.im + o.re;
+                if (q != p)
+                {
+                    dq.re = e.re + o.im;
+                    dq.im = o.re - e.im;
+                }
+            }
+        }
+        for (j = 0; j < 3; j ++) xfft(z[j], tmp, n, 1);
+
+        const double scale = 1.0 / (double) n;
+        double worst = 0;
+        bool ok = true;
+        for (k = 0; k < nc; k ++)
+        {
+            const double v[5] = { z[0][k].re * scale, z[0][k].im * scale, z[1][k].re * scale, z[1][k].im * scale,
+                                  z[2][k].re * scale };
+            uint64_t r = 0;
+            for (j = 0; j < 5; j ++)
+            {
+                const double f = floor(v[j] + 0.5), e = fabs(v[j] - f);
+                if (e > worst) worst = e;
+                if (f < 0) ok = false;
+                r += (uint64_t)(f < 0 ? 0 : f) << (j * s);
+            }
+            emit(k, r);
+        }
+
+        for (j = 0; j < 3; j ++) WDL_fft_aligned_free(z[j]);
+        WDL_fft_aligned_free(tmp);
+        if (max_err) *max_err = worst;
+        return ok && worst <= 0.25;
+    }
+};
@@ -0,0 +1,205 @@
+/*
+ **  Arbitrary-length FFT (Bluestein / chirp-z) on top of the WDLFFT
+ **  power-of-two kernels.
+ **
+ **  C++ wrapper (C)2024 DEMOS
+ **  GITHUB: https://github.com/mewza or Email: subband@protonmail.com
+ **  LICENSE: same as wdlfft.h
+ **
+ **  The DFT of any length N is rewritten as a circular convolution of
+ **  length M = 2^k >= 2N-1 using nk = (n^2 + k^2 - (k-n)^2) / 2:
+ **
+ **    X[k] = w[k] * sum_n (x[n] * w[n]) * conj(w[k-n]),  w[n] = exp(-i*pi*n^2/N)
+ **
+ **  The convolution runs through WDLFFT<T>::fft (c/u kernels) and
+ **  WDL_fft_complexmul. The chirp and the permuted, 1/M pre-scaled chirp
+ **  spectra are computed once per length and kept in a per-instance plan
+ **  cache, so the per-call cost is two M-point FFTs plus three pointwise
+ **  multiplies.
+ */
+
+#pragma once
+
+#include "wdlfft.h"
+
+template <typename T>
+class WDLFFT_Bluestein {
+public:
+
+    static const int32_t MAX_LEN = 1 << (FFT_MAXBITLEN - 1); // 2N-1 <= 32768
+
+    WDLFFT_Bluestein() : m_plans(0) { }
+
+    ~WDLFFT_Bluestein()
+    {
+        while (m_plans)
+        {
+            plan *p = m_plans;
+            m_plans = p->next;
+            WDLFFT<T>::free_buffer(p->chirp);
+            WDLFFT<T>::free_buffer(p->spec);
+            delete p;
+        }
+    }
+
+    /* Returns the power-of-two convolution size used for len, 0 if unsupported. */
+    static int32_t conv_size(int32_t len)
+    {
+        int32_t m = 4;
+        if (len < 1 || len > MAX_LEN) return 0;
+        while (m < 2 * len - 1) m <<= 1;
+        return m;
+    }
+
+    /*
+     * Precomputes the plan for len, so the first fft() call for that
+     * length does not allocate. Returns false if len is unsupported.
+     */
+    bool prepare(int32_t len)
+    {
+        return get_plan(len) != 0;
+    }
+
+    /*
+     * Expects cmplxT<T> buf[0..len-1], 1 <= len <= MAX_LEN, returns the
+     * unnormalized DFT in buf[0..len-1] in natural order (unlike
+     * WDLFFT<T>::fft, the output is not permuted). Forward uses
+     * exp(-2*pi*i*n*k/len), inverse exp(+2*pi*i*n*k/len); scale by 1.0/len
+     * after a roundtrip. Returns 0 on success, -1 if len is unsupported.
+     *
+     * NOTE: scratch comes from the calling thread's WDLFFT_Arena, so once
+     *       prepare() has run for every length, fft() may be called from
+     *       several threads at once. Creating plans is not thread safe.
+     */
+    int32_t fft(cmplxT<T> *buf, int32_t len, int32_t isInverse)
+    {
+        plan *p = get_plan(len);
+        if (!p) return -1;
+        if (len == 1) return 0;
+
+        const int32_t m = p->m;
+        const cmplxT<T> *w = p->chirp;
+        WDLFFT_Scratch scratch;
+        cmplxT<T> *work = scratch.get< cmplxT<T> >(m);
+        int32_t x;
+
+        if (!(len & (len - 1)))
+        {
+            // power of two: run the kernel directly, just undo the permutation
+            const int32_t *permute = WDLFFT<T>::WDL_fft_permute_tab(len);
+            if (!isInverse)
+            {
+                WDLFFT<T>::fft(buf, len, 0);
+                for (x = 0; x < len; x ++) work[x] = buf[permute[x]];
+            } else
+            {
+                for (x = 0; x < len; x ++) work[permute[x]] = buf[x];
+                WDLFFT<T>::fft(work, len, 1);
+            }
+            memcpy(buf, work, len * sizeof(cmplxT<T>));
+            return 0;
+        }
+
+        chirpmul(work, buf, w, len, isInverse);
+        memset(work + len, 0, (m - len) * sizeof(cmplxT<T>));
+
+        WDLFFT<T>::fft(work, m, 0);
+        m_fft.WDL_fft_complexmul(work, p->spec + (isInverse ? m : 0), m);
+        WDLFFT<T>::fft(work, m, 1);
+
+        chirpmul(buf, work, w, len, isInverse);
+        return 0;
+    }
+
+private:
+
+    WDLFFT_Bluestein(const WDLFFT_Bluestein &);
+    WDLFFT_Bluestein &operator=(const WDLFFT_Bluestein &);
+
+    struct plan {
+        int32_t len, m;
+        cmplxT<T> *chirp;   // w[0..len-1], forward direction
+        cmplxT<T> *spec;    // [0..m-1] forward, [m..2m-1] inverse, permuted, scaled 1/m; 0 for 2^k
+        plan *next;
+    };
+
+    plan *m_plans;
+    WDLFFT<T> m_fft;
+
+    /* out[n] = in[n] * w[n] (forward) or in[n] * conj(w[n]) (inverse) */
+    static void chirpmul(cmplxT<T> *out, const cmplxT<T> *in, const cmplxT<T> *w, int32_t n, int32_t conj)
+    {
+        T t1, t2;
+        int32_t x;
+
+        if (!conj)
+        {
+            for (x = 0; x < n; x ++)
+            {
+                t1 = in[x].re * w[x].re - in[x].im * w[x].im;
+                t2 = in[x].re * w[x].im + in[x].im * w[x].re;
+                out[x].re = t1;
+                out[x].im = t2;
+            }
+        } else
+        {
+            for (x = 0; x < n; x ++)
+            {
+                t1 = in[x].re * w[x].re + in[x].im * w[x].im;
+                t2 = in[x].im * w[x].re - in[x].re * w[x].im;
+                out[x].re = t1;
+                out[x].im = t2;
+            }
+        }
+    }
+
+    plan *get_plan(int32_t len)
+    {
+        plan *p;
+        for (p = m_plans; p; p = p->next) if (p->len == len) return p;
+
+        const int32_t m = conv_size(len);
+        if (!m) return 0;
+
+        WDLFFT<T>::WDL_fft_init();
+
+        p = new plan;
+        p->len = len;
+        p->m = m;
+        p->chirp = WDLFFT<T>::alloc_buffer(len);
+
+        int32_t x, dir;
+        for (x = 0; x < len; x ++)
+        {
+            // n^2 mod 2N keeps the angle exact for large n
+            const double a = M_PI * (double)(((int64_t)x * x) % (2 * (int64_t)len)) / len;
+            p->chirp[x].re = (T) cos(a);
+            p->chirp[x].im = (T) -sin(a);
+        }
+
+        p->spec = 0;
+        if (len & (len - 1))
+        {
+            p->spec = WDLFFT<T>::alloc_buffer(2 * m);
+
+            const T scale = (T) (1.0 / m);
+            for (dir = 0; dir < 2; dir ++)
+            {
+                // b[n] = b[m-n] = conj(w[n]) for the forward chirp, w[n] for the inverse one
+                cmplxT<T> *b = p->spec + dir * m;
+                memset(b, 0, m * sizeof(cmplxT<T>));
+                for (x = 0; x < len; x ++)
+                {
+                    b[x].re = p->chirp[x].re * scale;
+                    b[x].im = dir ? p->chirp[x].im * scale : -p->chirp[x].im * scale;
+                    if (x) b[m - x] = b[x];
+                }
+                WDLFFT<T>::fft(b, m, 0);
+            }
+        }
+
+        p->next = m_plans;
+        m_plans = p;
+        return p;
+    }
+};
@@ -0,0 +1,469 @@
+/*
+ **  Constant-Q transform with sparse spectral kernels on top of WDLFFT
+ **
+ **  C++ wrapper (C)2024 DEMOS
+ **  GITHUB: https://github.com/mewza or Email: subband@protonmail.com
+ **  LICENSE: same as wdlfft.h
+ **
+ **  Bin k sits at f_k = fmin * 2^(k/bins_per_octave), k = 0..bins()-1
+ **  up to fmax, with Q = 1 / (2^(1/bins_per_octave) - 1). Its kernel is a
+ **  Hann window of N_k = Q * fs / f_k samples times exp(2*pi*i*f_k*t/fs),
+ **  scaled so a sine of amplitude A at f_k gives |cq[k]| = A, with the
+ **  phase of the sine at the kernel center:
+ **
+ **    cq[k] = sum_t x[c+t] * w_k(t) * exp(-2*pi*i*f_k*t/fs) * 2 / sum(w_k)
+ **
+ **  Brown/Puckette: by Parseval that sum is a dot product of the input
+ **  spectrum with the kernel's spectrum, which is concentrated in a few
+ **  bins around f_k. The kernel spectra are computed once in init(), all
+ **  values below threshold * (kernel peak) dropped, and the rest stored
+ **  as (position in the real_fft output, weight) pairs, so one frame costs
+ **  one real_fft plus a sparse matrix-vector product; the permuted order
+ **  is folded into the positions. Bins 0 and N/2 and negative frequencies
+ **  are left out; a kernel's energy there is below -100 dB for
+ **  bins_per_octave >= 12. The default threshold of 1e-3 keeps the RMS
+ **  error against the direct sum near 0.13%; Brown/Puckette's 0.0054
+ **  gives 0.5% with about 40% fewer entries.
+ **
+ **  WDLFFT_CQT<T> does that on one frame of fft_size() samples with every
+ **  kernel centered at fft_size()/2. The lowest bin sets the size, so
+ **  fmin is limited to about Q * fs / 32768.
+ **
+ **  WDLFFT_CQTOctaves<T> is the streaming multi-octave variant
+ **  (Schoerkhuber/Klapuri): the top octave is transformed at fs, then the
+ **  input is low-passed and decimated by 2 per octave (59 tap halfband,
+ **  ~80 dB) and the same kernel shapes, small enough for a 256..2048
+ **  point real_fft, are applied to each octave in turn. The transforms
+ **  stay small however low fmin goes, and the decimation costs about 30
+ **  multiply-adds per input sample. Every octave is aligned on the same
+ **  input instant (fractional offsets are folded into each octave's
+ **  kernels), latency() samples behind the newest input.
+ **
+ **  T may be a vector type, each lane an independent channel.
+ */
+
+#pragma once
+
+#include "wdlfft.h"
+
+/* sparse kernel spectra for one real_fft size */
+template <typename T>
+class WDLFFT_CQKernels {
+public:
+
+    WDLFFT_CQKernels() : m_n(0), m_count(0), m_off(0), m_pos(0), m_w(0) { }
+    ~WDLFFT_CQKernels() { free_bufs(); }
+
+    /*
+     * n = real_fft size; freq[0..count-1] in cycles per sample; each kernel
+     * is Q / freq samples long and centered at sample center (may be
+     * fractional). Kernels must fit in [0, n).
+     */
+    void build(int32_t n, const double *freq, int32_t count, double q, double center, double threshold)
+    {
+        const int32_t half = n / 2;
+        const int32_t *perm = WDLFFT<T>::WDL_fft_permute_tab(half);
+        int32_t k, j, i, cap = 0;
+
+        free_bufs();
+        m_n = n;
+        m_count = count;
+
+        for (k = 0; k < count; k ++) cap += 2 * span(n, q / freq[k]) + 1;
+        m_off = new int32_t[count + 1];
+        m_pos = new int32_t[cap];
+        m_w = WDLFFT<T>::alloc_buffer(cap);
+
+        double *win = new double[n], *gre = new double[n], *gim = new double[n];
+        int32_t nnz = 0;
+
+        for (k = 0; k < count; k ++)
+        {
+            const double f = freq[k], nk = q / f;
+            int32_t n0 = (int32_t) ceil(center - nk * 0.5), n1 = (int32_t) floor(center + nk * 0.5);
+            if (n0 < 0) n0 = 0;
+            if (n1 > n - 1) n1 = n - 1;
+            double sum = 0, peak = 0;
+
+            for (i = n0; i <= n1; i ++)
+            {
+                win[i - n0] = 0.5 + 0.5 * cos(2.0 * M_PI * (i - center) / nk);
+                sum += win[i - n0];
+            }
+
+            // G[j] = sum_t g(t) exp(-2*pi*i*j*(c+t)/n), only around j = f*n
+            const int32_t w = span(n, nk), jc = (int32_t) floor(f * n + 0.5);
+            const int32_t j0 = jc - w < 1 ? 1 : jc - w, j1 = jc + w > half - 1 ? half - 1 : jc + w;
+            for (j = j0; j <= j1; j ++)
+            {
+                // phasor recurrence over t, restarted per bin
+                const double d = 2.0 * M_PI * (f - (double) j / n);
+                const double sr = cos(d), si = sin(d);
+                double pr = cos(d * (n0 - center)), pi = sin(d * (n0 - center)), ar = 0, ai = 0;
+                for (i = 0; i <= n1 - n0; i ++)
+                {
+                    ar += win[i] * pr;
+                    ai += win[i] * pi;
+                    const double t = pr * sr - pi * si;
+                    pi = pr * si + pi * sr;
+                    pr = t;
+                }
+                // the exp(-2*pi*i*j*c/n) factor
+                const double a = -2.0 * M_PI * j * center / n, cr = cos(a), ci = sin(a);
+                gre[j] = (ar * cr - ai * ci) * 2.0 / sum;
+                gim[j] = (ar * ci + ai * cr) * 2.0 / sum;
+                const double m = gre[j] * gre[j] + gim[j] * gim[j];
+                if (m > peak) peak = m;
+            }
+
+            // real_fft holds 2*X[j]: weight conj(G[j]) / (2n)
+            m_off[k] = nnz;
+            for (j = j0; j <= j1; j ++)
+            {
+                if (gre[j] * gre[j] + gim[j] * gim[j] < threshold * threshold * peak) continue;
+                m_pos[nnz] = perm[j];
+                m_w[nnz].re = (T)(gre[j] / (2.0 * n));
+                m_w[nnz].im = (T)(-gim[j] / (2.0 * n));
+                nnz ++;
+            }
+        }
+        m_off[count] = nnz;
+
+        delete [] win;
+        delete [] gre;
+        delete [] gim;
+    }
+
+    /* out[k] = kernel k applied to spec, the output of WDLFFT<T>::real_fft(.., n, 0) */
+    void apply(const T *spec, cmplxT<T> *out) const
+    {
+        const cmplxT<T> *s = (const cmplxT<T> *) spec;
+        int32_t k, e;
+        for (k = 0; k < m_count; k ++)
+        {
+            T re = 0, im = 0;
+            for (e = m_off[k]; e < m_off[k + 1]; e ++)
+            {
+                const cmplxT<T> &x = s[m_pos[e]], &w = m_w[e];
+                re += x.re * w.re - x.im * w.im;
+                im += x.re * w.im + x.im * w.re;
+            }
+            out[k].re = re;
+            out[k].im = im;
+        }
+    }
+
+    int32_t nnz() const { return m_off ? m_off[m_count] : 0; }
+
+private:
+
+    // owns the sparse kernel arrays
+    WDLFFT_CQKernels(const WDLFFT_CQKernels &);
+    WDLFFT_CQKernels &operator=(const WDLFFT_CQKernels &);
+
+    /* half width in bins that holds everything above -100 dB of a Hann kernel of nk samples */
+    static int32_t span(int32_t n, double nk) { return (int32_t)(16.0 * n / nk) + 2; }
+
+    void free_bufs()
+    {
+        delete [] m_off;
+        delete [] m_pos;
+        WDLFFT<T>::free_buffer(m_w);
+        m_off = m_pos = 0;
+        m_w = 0;
+    }
+
+    int32_t m_n, m_count;
+    int32_t *m_off, *m_pos;     // per kernel [m_off[k], m_off[k+1]) into m_pos / m_w
+    cmplxT<T> *m_w;
+};
+
+template <typename T>
+class WDLFFT_CQT {
+public:
+
+    WDLFFT_CQT() : m_n(0), m_bins(0), m_fs(0), m_fmin(0), m_bpo(0), m_work(0) { }
+    ~WDLFFT_CQT() { WDLFFT<T>::free_buffer(m_work); }
+
+    /*
+     * Bins from fmin up to fmax (Hz, fs the sample rate), bins_per_octave
+     * >= 12. Returns false if the lowest kernel needs more than 32768
+     * samples or the top one reaches past fs/2.
+     */
+    bool init(double fs, double fmin, double fmax, int32_t bins_per_octave, double threshold = 1e-3)
+    {
+        int32_t k;
+        m_n = m_bins = 0;
+        if (bins_per_octave < 12 || fmin <= 0 || fmax < fmin || fs <= 0) return false;
+
+        const double q = 1.0 / (pow(2.0, 1.0 / bins_per_octave) - 1.0);
+        const int32_t bins = (int32_t) floor(bins_per_octave * log2(fmax / fmin) + 1e-9) + 1;
+        const double top = fmin * pow(2.0, (bins - 1) / (double) bins_per_octave);
+        if (top * (1.0 + 2.0 / q) > 0.5 * fs) return false;
+
+        int32_t n = 64;
+        while (n < q * fs / fmin) n *= 2;
+        if (n > (1 << FFT_MAXBITLEN)) return false;
+
+        WDLFFT<T>::WDL_fft_init();
+
+        double *freq = new double[bins];
+        for (k = 0; k < bins; k ++) freq[k] = fmin * pow(2.0, k / (double) bins_per_octave) / fs;
+        m_kernels.build(n, freq, bins, q, n * 0.5, threshold);
+        delete [] freq;
+
+        WDLFFT<T>::free_buffer(m_work);
+        m_work = WDLFFT<T>::alloc_buffer(n / 2);
+        m_n = n;
+        m_bins = bins;
+        m_fs = fs;
+        m_fmin = fmin;
+        m_bpo = bins_per_octave;
+        return true;
+    }
+
+    int32_t bins() const { return m_bins; }
+    int32_t fft_size() const { return m_n; }
+    int32_t nnz() const { return m_kernels.nnz(); }
+    double freq(int32_t k) const { return m_fmin * pow(2.0, k / (double) m_bpo); }
+
+    /* frame holds fft_size() samples, out gets bins() values centered on frame[fft_size()/2] */
+    void transform(const T *frame, cmplxT<T> *out)
+    {
+        T *w = (T *) m_work;
+        memcpy(w, frame, m_n * sizeof(T));
+        WDLFFT<T>::real_fft(w, m_n, 0);
+        m_kernels.apply(w, out);
+    }
+
+private:
+
+    // owns the work buffer
+    WDLFFT_CQT(const WDLFFT_CQT &);
+    WDLFFT_CQT &operator=(const WDLFFT_CQT &);
+
+    int32_t m_n, m_bins;
+    double m_fs, m_fmin;
+    int32_t m_bpo;
+    cmplxT<T> *m_work;
+    WDLFFT_CQKernels<T> m_kernels;
+};
+
+template <typename T>
+class WDLFFT_CQTOctaves {
+public:
+
+    enum { MAX_OCTAVES = 16, HB_C = 29 };  // halfband: 2*HB_C+1 taps, delay HB_C
+
+    WDLFFT_CQTOctaves() : m_oct(0), m_n(0), m_bins(0), m_bpo(0), m_hop(0), m_latency(0), m_pend(0),
+                          m_fmin(0), m_work(0)
+    {
+        memset(m_buf, 0, sizeof(m_buf));
+    }
+    ~WDLFFT_CQTOctaves() { free_bufs(); }
+
+    /*
+     * As WDLFFT_CQT::init, plus hop = input samples between frames, a
+     * multiple of 2^(octaves()-1). The top bin and its kernel bandwidth
+     * must stay below 0.4 * fs for the halfband. Returns false otherwise.
+     */
+    bool init(double fs, double fmin, double fmax, int32_t bins_per_octave, int32_t hop, double threshold = 1e-3)
+    {
+        int32_t o, k;
+        free_bufs();
+        if (bins_per_octave < 12 || fmin <= 0 || fmax < fmin || fs <= 0 || hop < 1) return false;
+
+        const double q = 1.0 / (pow(2.0, 1.0 / bins_per_octave) - 1.0);
+        const int32_t bins = (int32_t) floor(bins_per_octave * log2(fmax / fmin) + 1e-9) + 1;
+        const int32_t oct = (bins + bins_per_octave - 1) / bins_per_octave;
+        const double top = fmin * pow(2.0, (bins - 1) / (double) bins_per_octave);
+        if (oct > MAX_OCTAVES || top * (1.0 + 2.0 / q) > 0.4 * fs) return false;
+        if (hop % (1 << (oct - 1))) return false;
+
+        // the longest kernel is the lowest bin of the top octave, at fs
+        const int32_t lo0 = bins > bins_per_octave ? bins - bins_per_octave : 0;
+        const double f0 = fmin * pow(2.0, lo0 / (double) bins_per_octave);
+        int32_t n = 64;
+        while (n < q * fs / f0) n *= 2;
+        if (n > (1 << FFT_MAXBITLEN)) return false;
+
+        WDLFFT<T>::WDL_fft_init();
+
+        m_oct = oct;
+        m_n = n;
+        m_bins = bins;
+        m_bpo = bins_per_octave;
+        m_hop = hop;
+        m_fmin = fmin;
+        m_latency = (1 << (oct - 1)) * (n / 2) + HB_C * ((1 << (oct - 1)) - 1);
+
+        double *freq = new double[bins_per_octave];
+        for (o = 0; o < oct; o ++)
+        {
+            // window start a_o samples back from the newest, kernel center
+            // at a fractional offset, so every octave centers on input time S - latency
+            const double v = (HB_C * ((1 << o) - 1) - m_latency) / (double)(1 << o) - n * 0.5;
+            const double s = floor(v);
+            m_back[o] = (int32_t) -s;
+
+            m_lo[o] = bins - (o + 1) * bins_per_octave < 0 ? 0 : bins - (o + 1) * bins_per_octave;
+            m_hi[o] = bins - o * bins_per_octave;
+            for (k = m_lo[o]; k < m_hi[o]; k ++)
+                freq[k - m_lo[o]] = fmin * pow(2.0, k / (double) bins_per_octave) * (1 << o) / fs;
+            m_kernels[o].build(n, freq, m_hi[o] - m_lo[o], q, n * 0.5 + (v - s), threshold);
+
+            m_hist[o] = m_back[o] > 2 * HB_C + 1 ? m_back[o] : 2 * HB_C + 1;
+            m_cap[o] = 2 * m_hist[o] + (hop >> o);
+            m_buf[o] = (T *) WDLFFT<T>::alloc_buffer((m_cap[o] + 1) / 2);
+        }
+        delete [] freq;
+
+        design_halfband(m_hb);
+        m_work = WDLFFT<T>::alloc_buffer(n / 2);
+        reset();
+        return true;
+    }
+
+    /* zero history */
+    void reset()
+    {
+        int32_t o;
+        for (o = 0; o < m_oct; o ++)
+        {
+            memset(m_buf[o], 0, m_hist[o] * sizeof(T));
+            m_fill[o] = m_hist[o];
+        }
+        m_pend = 0;
+    }
+
+    int32_t bins() const { return m_bins; }
+    int32_t octaves() const { return m_oct; }
+    int32_t fft_size() const { return m_n; }
+    int32_t hop() const { return m_hop; }
+    int32_t nnz() const { int32_t o, r = 0; for (o = 0; o < m_oct; o ++) r += m_kernels[o].nnz(); return r; }
+    double freq(int32_t k) const { return m_fmin * pow(2.0, k / (double) m_bpo); }
+
+    /* a frame emitted after input sample S-1 is centered on input sample S - latency() */
+    int32_t latency() const { return m_latency; }
+
+    /*
+     * Consumes n samples, writes bins() values per completed hop to out
+     * and returns the number of frames. out must hold (n / hop() + 1) * bins().
+     */
+    int32_t process(const T *in, int32_t n, cmplxT<T> *out)
+    {
+        int32_t frames = 0, o;
+        while (n > 0)
+        {
+            int32_t c = m_hop - m_pend;
+            if (c > n) c = n;
+            memcpy(m_buf[0] + m_fill[0], in, c * sizeof(T));
+            m_fill[0] += c;
+            m_pend += c;
+            in += c;
+            n -= c;
+            if (m_pend < m_hop) break;
+
+            m_pend = 0;
+            for (o = 0; o + 1 < m_oct; o ++) decimate(o);
+
+            for (o = 0; o < m_oct; o ++)
+            {
+                T *w = (T *) m_work;
+                memcpy(w, m_buf[o] + m_fill[o] - m_back[o], m_n * sizeof(T));
+                WDLFFT<T>::real_fft(w, m_n, 0);
+                m_kernels[o].apply(w, out + m_lo[o]);
+            }
+            out += m_bins;
+            frames ++;
+
+            for (o = 0; o < m_oct; o ++) compact(o);
+        }
+        return frames;
+    }
+
+    /* lowpass at fs/4, Kaiser (beta 8) windowed sinc: h[c+d] for d = 0, 1, 3, .., HB_C */
+    static void design_halfband(double *h)
+    {
+        const double i0b = bessel_i0(8.0);
+        int32_t d;
+        for (d = 0; d <= HB_C; d ++)
+        {
+            const double r = (double) d / HB_C;
+            const double w = bessel_i0(8.0 * sqrt(1.0 - r * r)) / i0b;
+            h[d] = d == 0 ? 0.5 : (d & 1) ? w * sin(M_PI * d * 0.5) / (M_PI * d) : 0.0;
+        }
+        // unity DC gain: 2 * sum of the odd taps is 1 - h[0]
+        double sum = 0;
+        for (d = 1; d <= HB_C; d += 2) sum += 2.0 * h[d];
+        for (d = 1; d <= HB_C; d += 2) h[d] *= 0.5 / sum;
+    }
+
+private:
+
+    // owns the per-octave histories and the work buffer
+    WDLFFT_CQTOctaves(const WDLFFT_CQTOctaves &);
+    WDLFFT_CQTOctaves &operator=(const WDLFFT_CQTOctaves &);
+
+    static double bessel_i0(double x)
+    {
+        double s = 1, t = 1;
+        int32_t k;
+        for (k = 1; k < 40; k ++)
+        {
+            t *= (x * 0.5 / k) * (x * 0.5 / k);
+            s += t;
+        }
+        return s;
+    }
+
+    /* octave o's new hop >> o samples -> hop >> (o+1) samples of octave o+1 */
+    void decimate(int32_t o)
+    {
+        const int32_t cnt = m_hop >> (o + 1);
+        const T *x = m_buf[o] + m_fill[o] - (m_hop >> o);
+        T *y = m_buf[o + 1] + m_fill[o + 1];
+        int32_t m, d;
+
+        // y[m] = sum h[n] x[2m - n], n = 0..2*HB_C: centered on x[2m - HB_C]
+        for (m = 0; m < cnt; m ++)
+        {
+            const T *c = x + 2 * m - HB_C;
+            T acc = c[0] * (T) m_hb[0];
+            for (d = 1; d <= HB_C; d += 2) acc += (c[-d] + c[d]) * (T) m_hb[d];
+            y[m] = acc;
+        }
+        m_fill[o + 1] += cnt;
+    }
+
+    /* keep m_hist[o] samples when the next hop would not fit */
+    void compact(int32_t o)
+    {
+        if (m_fill[o] + (m_hop >> o) <= m_cap[o]) return;
+        memmove(m_buf[o], m_buf[o] + m_fill[o] - m_hist[o], m_hist[o] * sizeof(T));
+        m_fill[o] = m_hist[o];
+    }
+
+    void free_bufs()
+    {
+        int32_t o;
+        for (o = 0; o < MAX_OCTAVES; o ++)
+        {
+            WDLFFT<T>::free_buffer(m_buf[o]);
+            m_buf[o] = 0;
+        }
+        WDLFFT<T>::free_buffer(m_work);
+        m_work = 0;
+        m_oct = 0;
+    }
+
+    int32_t m_oct, m_n, m_bins, m_bpo, m_hop, m_latency, m_pend;
+    double m_fmin;
+    double m_hb[HB_C + 1];
+    int32_t m_lo[MAX_OCTAVES], m_hi[MAX_OCTAVES];   // bins of octave o
+    int32_t m_back[MAX_OCTAVES];                    // window start, samples back from the newest
+    int32_t m_hist[MAX_OCTAVES], m_cap[MAX_OCTAVES], m_fill[MAX_OCTAVES];
+    T *m_buf[MAX_OCTAVES];                          // octave o at fs / 2^o
+    cmplxT<T> *m_work;
+    WDLFFT_CQKernels<T> m_kernels[MAX_OCTAVES];
+};
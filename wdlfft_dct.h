@@ -0,0 +1,221 @@
+/*
+ **  DCT-II / DCT-III / DCT-IV and MDCT / IMDCT on top of WDLFFT
+ **
+ **  C++ wrapper (C)2024 DEMOS
+ **  GITHUB: https://github.com/mewza or Email: subband@protonmail.com
+ **  LICENSE: same as wdlfft.h
+ **
+ **  All transforms of length N run through one N/2-point complex FFT
+ **  (real_fft for DCT-II/III, fft for DCT-IV) with precomputed pre/post
+ **  twiddles, and read/write the FFT data in WDL_fft_permute order so
+ **  no reorder pass is needed. T may be a vector type, in which case
+ **  every lane is an independent channel.
+ **
+ **  Unnormalized definitions, n,k = 0..N-1:
+ **
+ **    DCT-II   X[k] = sum x[n] cos(pi*(2n+1)*k/(2N))
+ **    DCT-III  x[n] = X[0]/2 + sum_{k>0} X[k] cos(pi*(2n+1)*k/(2N))
+ **    DCT-IV   X[k] = sum x[n] cos(pi*(2n+1)*(2k+1)/(4N))
+ **
+ **  dct3(dct2(x)) = dct4(dct4(x)) = N/2 * x.
+ **
+ **    MDCT     X[k] = sum_{n<2N} x[n] cos(pi/N*(n+1/2+N/2)*(k+1/2))
+ **    IMDCT    y[n] = sum_{k<N} X[k] cos(pi/N*(n+1/2+N/2)*(k+1/2)), n < 2N
+ **
+ **  With a Princen-Bradley window w applied before mdct and after imdct,
+ **  overlap-adding frames with hop N reconstructs N/2 * x.
+ */
+
+#pragma once
+
+#include "wdlfft.h"
+
+template <typename T>
+class WDLFFT_DCT {
+public:
+
+    WDLFFT_DCT() : m_n(0), m_tw2(0), m_tw4(0) { }
+    ~WDLFFT_DCT() { free_tabs(); }
+
+    /* n is a power of two, 4 <= n <= 32768. Returns false otherwise. */
+    bool init(int32_t n)
+    {
+        int32_t k;
+        if (n == m_n) return true;
+        free_tabs();
+        if (n < 4 || n > (1 << FFT_MAXBITLEN) || (n & (n - 1))) return false;
+
+        WDLFFT<T>::WDL_fft_init();
+
+        const int32_t half = n >> 1;
+        m_n = n;
+        m_tw2 = WDLFFT<T>::alloc_buffer(half);
+        m_tw4 = WDLFFT<T>::alloc_buffer(n);
+
+        for (k = 0; k < half; k ++)
+        {
+            // DCT-II post-twiddle 0.5*exp(-i*pi*k/(2N)), the 0.5 undoes real_fft's gain of 2
+            const double a = M_PI * k / (2.0 * n);
+            m_tw2[k].re = (T) (0.5 * cos(a));
+            m_tw2[k].im = (T) (-0.5 * sin(a));
+
+            // DCT-IV pre-twiddle exp(-i*pi*(4k+1)/(4N)) and post-twiddle exp(-i*pi*k/N)
+            const double b = M_PI * (4 * k + 1) / (4.0 * n), c = M_PI * k / n;
+            m_tw4[k].re = (T) cos(b);
+            m_tw4[k].im = (T) -sin(b);
+            m_tw4[half + k].re = (T) cos(c);
+            m_tw4[half + k].im = (T) -sin(c);
+        }
+        return true;
+    }
+
+    int32_t size() const { return m_n; }
+
+    /* out[0..N-1] = DCT-II(in[0..N-1]), in == out is allowed */
+    void dct2(const T *in, T *out)
+    {
+        const int32_t n = m_n, half = n >> 1;
+        const int32_t *permute = WDLFFT<T>::WDL_fft_permute_tab(half);
+        WDLFFT_Scratch scratch;
+        cmplxT<T> *V = scratch.get< cmplxT<T> >(half);
+        T *v = (T *)V;
+        int32_t k;
+
+        // Makhoul reordering: even samples forward, odd samples backward
+        for (k = 0; k < half; k ++)
+        {
+            v[k] = in[2 * k];
+            v[n - 1 - k] = in[2 * k + 1];
+        }
+
+        WDLFFT<T>::real_fft(v, n, 0);
+
+        out[0] = V[0].re * (T) 0.5;
+        out[half] = V[0].im * (T) (0.5 * M_SQRT1_2);
+
+        for (k = 1; k < half; k ++)
+        {
+            const cmplxT<T> &p = V[permute[k]], &w = m_tw2[k];
+            out[k] = p.re * w.re - p.im * w.im;
+            out[n - k] = -(p.re * w.im + p.im * w.re);
+        }
+    }
+
+    /* out[0..N-1] = DCT-III(in[0..N-1]), in == out is allowed */
+    void dct3(const T *in, T *out)
+    {
+        const int32_t n = m_n, half = n >> 1;
+        const int32_t *permute = WDLFFT<T>::WDL_fft_permute_tab(half);
+        WDLFFT_Scratch scratch;
+        cmplxT<T> *V = scratch.get< cmplxT<T> >(half);
+        int32_t k;
+
+        V[0].re = in[0] * (T) 0.5;
+        V[0].im = in[half] * (T) M_SQRT1_2;
+
+        // V[k] = conj(tw2[k]) * (X[k] - i*X[N-k]), tw2 already carries the 0.5
+        for (k = 1; k < half; k ++)
+        {
+            const cmplxT<T> &w = m_tw2[k];
+            const T a = in[k], b = in[n - k];
+            cmplxT<T> &p = V[permute[k]];
+            p.re = a * w.re - b * w.im;
+            p.im = -(a * w.im + b * w.re);
+        }
+
+        T *v = (T *)V;
+        WDLFFT<T>::real_fft(v, n, 1);
+
+        for (k = 0; k < half; k ++)
+        {
+            out[2 * k] = v[k];
+            out[2 * k + 1] = v[n - 1 - k];
+        }
+    }
+
+    /* out[0..N-1] = DCT-IV(in[0..N-1]), in == out is allowed */
+    void dct4(const T *in, T *out)
+    {
+        const int32_t n = m_n, half = n >> 1;
+        const int32_t *permute = WDLFFT<T>::WDL_fft_permute_tab(half);
+        const cmplxT<T> *pre = m_tw4, *post = m_tw4 + half;
+        WDLFFT_Scratch scratch;
+        cmplxT<T> *z = scratch.get< cmplxT<T> >(half);
+        int32_t k;
+
+        // z[k] = (x[2k] + i*x[N-1-2k]) * exp(-i*pi*(4k+1)/(4N))
+        for (k = 0; k < half; k ++)
+        {
+            const T a = in[2 * k], b = in[n - 1 - 2 * k];
+            z[k].re = a * pre[k].re - b * pre[k].im;
+            z[k].im = a * pre[k].im + b * pre[k].re;
+        }
+
+        WDLFFT<T>::fft(z, half, 0);
+
+        for (k = 0; k < half; k ++)
+        {
+            const cmplxT<T> &p = z[permute[k]];
+            out[2 * k] = p.re * post[k].re - p.im * post[k].im;
+            out[n - 1 - 2 * k] = -(p.re * post[k].im + p.im * post[k].re);
+        }
+    }
+
+    /* out[0..N-1] = MDCT(in[0..2N-1]), in and out must not overlap */
+    void mdct(const T *in, T *out)
+    {
+        const int32_t n = m_n, h = n >> 1;
+        int32_t k;
+
+        // fold (a, b, c, d) -> (-c_r - d, a - b_r), then DCT-IV
+        for (k = 0; k < h; k ++)
+        {
+            out[k] = -in[3 * h - 1 - k] - in[3 * h + k];
+            out[h + k] = in[k] - in[n - 1 - k];
+        }
+        dct4(out, out);
+    }
+
+    /* out[0..2N-1] = IMDCT(in[0..N-1]), in and out must not overlap */
+    void imdct(const T *in, T *out)
+    {
+        const int32_t n = m_n, h = n >> 1;
+        int32_t k;
+
+        T *u = out + n;
+        dct4(in, u);
+
+        // unfold u = (u1, u2) -> (u2, -u2_r, -u1_r, -u1). The first half of out
+        // only reads u2, the second half is u1 rewritten in place in pairs.
+        for (k = 0; k < h; k ++)
+        {
+            out[k] = u[h + k];
+            out[n - 1 - k] = -u[h + k];
+        }
+        for (k = 0; k < h / 2; k ++)
+        {
+            const T a = u[k], b = u[h - 1 - k];
+            out[3 * h + k] = -a;
+            out[4 * h - 1 - k] = -b;
+            u[k] = -b;
+            u[h - 1 - k] = -a;
+        }
+    }
+
+private:
+
+    WDLFFT_DCT(const WDLFFT_DCT &);
+    WDLFFT_DCT &operator=(const WDLFFT_DCT &);
+
+    int32_t m_n;
+    cmplxT<T> *m_tw2;   // [0..N/2-1] DCT-II/III twiddles
+    cmplxT<T> *m_tw4;   // [0..N/2-1] DCT-IV pre, [N/2..N-1] post twiddles
+
+    void free_tabs()
+    {
+        WDLFFT<T>::free_buffer(m_tw2);
+        WDLFFT<T>::free_buffer(m_tw4);
+        m_tw2 = m_tw4 = 0;
+        m_n = 0;
+    }
+};
@@ -0,0 +1,277 @@
+/*
+ **  Q15 / Q31 fixed-point FFT with the WDLFFT permuted output order
+ **
+ **  C++ wrapper (C)2024 DEMOS
+ **  GITHUB: https://github.com/mewza or Email: subband@protonmail.com
+ **  LICENSE: same as wdlfft.h
+ **
+ **  WDLFFT_Fixed<int16_t> (Q15) and WDLFFT_Fixed<int32_t> (Q31) run a
+ **  radix-2 transform, len = 2..32768, on cmplxT<Q>. The output lands in
+ **  the same WDL_fft_permute(len) order as WDLFFT<T>::fft, so code that
+ **  walks the float spectrum walks this one unchanged, and the inverse
+ **  takes that order back to natural. The sign convention is WDLFFT's.
+ **
+ **  Every operation is integer and fully specified, so results are
+ **  bit-exact on any compiler and CPU:
+ **
+ **    twiddles  w[k] = round(2^F * exp(-+2*pi*i*k/len)), +-1.0 clamped to +-(2^F-1)
+ **    multiply  (a*b + c*d + 2^(F-1)) >> F in the double-width type
+ **    halving   x / 2 rounded half to even: (x + ((x >> 1) & 1)) >> 1
+ **    store     saturate to [-2^F, 2^F-1]
+ **
+ **  with F = 15 or 31. Forward is decimation in frequency: per butterfly
+ **  s = a+b, d = a-b, both halved if the stage is scaled, then d*w
+ **  (k = 0 is not multiplied). Inverse is decimation in time on the
+ **  conjugate twiddles: t = b*w, then a+t, a-t, halved if scaled.
+ **
+ **  Bit s of scale_stages scales stage s (stage 0 runs first). The
+ **  default halves every stage, so the forward output is X/len and can
+ **  never overflow; a forward with every stage scaled followed by an
+ **  inverse with scale_stages = 0 returns the input within about
+ **  2*sqrt(len) LSB; any split with every stage scaled once does the
+ **  same. Unscaled stages saturate instead of wrapping.
+ **
+ **  Tables (about 64 KB of twiddles and 256 KB of indices for Q15) are
+ **  built on first use and need neither WDL_fft_init nor DECL_WDLFFT.
+ */
+
+#pragma once
+
+#include "wdlfft.h"
+
+#ifdef WDL_FFT_NO_PERMUTE
+#error "wdlfft_fixed.h needs WDLFFT<T>::fftfreq_c, undefine WDL_FFT_NO_PERMUTE"
+#endif
+
+template <typename Q> struct wdl_fft_qtraits;
+
+template <> struct wdl_fft_qtraits<int16_t> {
+    typedef int32_t wide_t;
+    static const int32_t FRAC = 15;
+};
+
+template <> struct wdl_fft_qtraits<int32_t> {
+    typedef int64_t wide_t;
+    static const int32_t FRAC = 31;
+};
+
+template <typename Q>
+class WDLFFT_Fixed {
+public:
+
+    typedef typename wdl_fft_qtraits<Q>::wide_t wide_t;
+
+    static const int32_t FRAC = wdl_fft_qtraits<Q>::FRAC;
+    static const int32_t MAX_LEN = 1 << FFT_MAXBITLEN;
+
+    /*
+     * Expects cmplxT<Q> buf[0..len-1] in natural order, returns the
+     * spectrum ordered by WDL_fft_permute(len); the inverse takes that
+     * order and returns natural order. Returns 0, or -1 (and leaves buf
+     * alone) if len is not a power of two in 2..32768.
+     */
+    static int32_t fft(cmplxT<Q> *buf, int32_t len, int32_t isInverse, uint32_t scale_stages = ~0u)
+    {
+        if (len < 2 || len > MAX_LEN || (len & (len - 1))) return -1;
+
+        const tables &tab = get_tables();
+        const int32_t *perm = tab.perm + len - 2;
+        WDLFFT_Scratch scratch;
+        cmplxT<Q> *tmp = scratch.get< cmplxT<Q> >(len);
+        int32_t i;
+
+        if (!isInverse)
+        {
+            dif(buf, len, tab.w, scale_stages);
+            for (i = 0; i < len; i ++) tmp[perm[i]] = buf[i];
+            memcpy(buf, tmp, len * sizeof(cmplxT<Q>));
+        } else
+        {
+            for (i = 0; i < len; i ++) tmp[i] = buf[perm[i]];
+            dit(tmp, len, tab.w, scale_stages);
+            memcpy(buf, tmp, len * sizeof(cmplxT<Q>));
+        }
+        return 0;
+    }
+
+    /* dest[i] = saturate(round(src[i] * 2^FRAC)) */
+    static void from_float(Q *dest, const float *src, size_t n)
+    {
+        size_t i;
+        for (i = 0; i < n; i ++)
+        {
+            double v = floor((double) src[i] * (double)((wide_t) 1 << FRAC) + 0.5);
+            if (v > (double) qmax()) v = (double) qmax();
+            else if (v < (double) qmin()) v = (double) qmin();
+            dest[i] = (Q) v;
+        }
+    }
+
+    /* dest[i] = src[i] / 2^FRAC * scale */
+    static void to_float(float *dest, const Q *src, size_t n, float scale = 1.0f)
+    {
+        const double s = (double) scale / (double)((wide_t) 1 << FRAC);
+        size_t i;
+        for (i = 0; i < n; i ++) dest[i] = (float)((double) src[i] * s);
+    }
+
+private:
+
+    struct tables {
+        cmplxT<Q> w[MAX_LEN / 2];       // exp(-2*pi*i*k/MAX_LEN)
+        int32_t perm[2 * MAX_LEN];      // per len at [len-2]: WDL_fft_permute_tab(len) after bit reversal
+
+        tables()
+        {
+            int32_t k, n, bits;
+            for (k = 0; k < MAX_LEN / 2; k ++)
+            {
+                const double a = 2.0 * M_PI * k / MAX_LEN;
+                w[k].re = round_q(cos(a));
+                w[k].im = round_q(-sin(a));
+            }
+
+            for (n = 2, bits = 1; n <= MAX_LEN; n *= 2, bits ++)
+            {
+                // same construction as idx_perm_calc: p[bin] = storage position
+                int32_t *p = perm + n - 2, i;
+                p[0] = 0;
+                for (i = 1; i < n; i ++) p[n - (int32_t) WDLFFT<float>::fftfreq_c(i, n)] = i;
+
+                // the radix-2 passes leave bin bitrev(i) at i, so fold the
+                // bit reversal into the table: p[i] = p[bitrev(i)], swapping pairs
+                for (i = 0; i < n; i ++)
+                {
+                    const int32_t r = bitrev(i, bits);
+                    if (r > i)
+                    {
+                        const int32_t t = p[i];
+                        p[i] = p[r];
+                        p[r] = t;
+                    }
+                }
+            }
+        }
+    };
+
+    static const tables &get_tables()
+    {
+        static const tables tab;        // built once, thread-safe, freed at exit
+        return tab;
+    }
+
+    static Q qmax() { return (Q)(((wide_t) 1 << FRAC) - 1); }
+    static Q qmin() { return (Q)(-((wide_t) 1 << FRAC)); }
+
+    static Q round_q(double v)
+    {
+        v = floor(v * (double)((wide_t) 1 << FRAC) + 0.5);
+        if (v >= (double) qmax()) return qmax();
+        if (v <= -(double) qmax()) return (Q) -qmax();
+        return (Q) v;
+    }
+
+    static int32_t bitrev(int32_t i, int32_t bits)
+    {
+        int32_t r = 0;
+        while (bits --)
+        {
+            r = (r << 1) | (i & 1);
+            i >>= 1;
+        }
+        return r;
+    }
+
+    static __inline Q sat(wide_t v)
+    {
+        return v > (wide_t) qmax() ? qmax() : v < (wide_t) qmin() ? qmin() : (Q) v;
+    }
+
+    static __inline wide_t half(wide_t v) { return (v + ((v >> 1) & 1)) >> 1; }
+
+    /* (a.re*w.re - a.im*w.im, a.re*w.im + a.im*w.re), w.im negated if conj, dst may be a;
+       |w| < 2^F so neither sum overflows */
+    static __inline void cmul(cmplxT<Q> &dst, const cmplxT<Q> &a, const cmplxT<Q> &w, bool conj)
+    {
+        const wide_t wi = conj ? -(wide_t) w.im : (wide_t) w.im;
+        const wide_t rnd = (wide_t) 1 << (FRAC - 1);
+        const wide_t re = ((wide_t) a.re * w.re - (wide_t) a.im * wi + rnd) >> FRAC;
+        const wide_t im = ((wide_t) a.re * wi + (wide_t) a.im * w.re + rnd) >> FRAC;
+        dst.re = sat(re);
+        dst.im = sat(im);
+    }
+
+    /* a, b = a+b, a-b, halved if SC */
+    template <bool SC>
+    static __inline void bfly(cmplxT<Q> &a, cmplxT<Q> &b, const cmplxT<Q> &t)
+    {
+        wide_t sr = (wide_t) a.re + t.re, si = (wide_t) a.im + t.im;
+        wide_t dr = (wide_t) a.re - t.re, di = (wide_t) a.im - t.im;
+        if (SC)
+        {
+            sr = half(sr); si = half(si);
+            dr = half(dr); di = half(di);
+        }
+        a.re = sat(sr);
+        a.im = sat(si);
+        b.re = sat(dr);
+        b.im = sat(di);
+    }
+
+    template <bool SC>
+    static void dif_stage(cmplxT<Q> *buf, int32_t len, int32_t h, const cmplxT<Q> *w)
+    {
+        const int32_t step = MAX_LEN / (2 * h);
+        int32_t j, k;
+        for (j = 0; j < len; j += 2 * h)
+        {
+            cmplxT<Q> *a = buf + j, *b = buf + j + h;
+            bfly<SC>(a[0], b[0], b[0]);
+            for (k = 1; k < h; k ++)
+            {
+                bfly<SC>(a[k], b[k], b[k]);
+                cmul(b[k], b[k], w[k * step], false);
+            }
+        }
+    }
+
+    template <bool SC>
+    static void dit_stage(cmplxT<Q> *buf, int32_t len, int32_t h, const cmplxT<Q> *w)
+    {
+        const int32_t step = MAX_LEN / (2 * h);
+        int32_t j, k;
+        for (j = 0; j < len; j += 2 * h)
+        {
+            cmplxT<Q> *a = buf + j, *b = buf + j + h;
+            bfly<SC>(a[0], b[0], b[0]);
+            for (k = 1; k < h; k ++)
+            {
+                cmplxT<Q> t;
+                cmul(t, b[k], w[k * step], true);
+                bfly<SC>(a[k], b[k], t);
+            }
+        }
+    }
+
+    /* natural order in, bit-reversed out */
+    static void dif(cmplxT<Q> *buf, int32_t len, const cmplxT<Q> *w, uint32_t scale_stages)
+    {
+        int32_t h, stage = 0;
+        for (h = len >> 1; h >= 1; h >>= 1, stage ++)
+        {
+            if ((scale_stages >> stage) & 1) dif_stage<true>(buf, len, h, w);
+            else dif_stage<false>(buf, len, h, w);
+        }
+    }
+
+    /* bit-reversed order in, natural out */
+    static void dit(cmplxT<Q> *buf, int32_t len, const cmplxT<Q> *w, uint32_t scale_stages)
+    {
+        int32_t h, stage = 0;
+        for (h = 1; h < len; h <<= 1, stage ++)
+        {
+            if ((scale_stages >> stage) & 1) dit_stage<true>(buf, len, h, w);
+            else dit_stage<false>(buf, len, h, w);
+        }
+    }
+};
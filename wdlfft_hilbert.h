@@ -0,0 +1,236 @@
+/*
+ **  Hilbert transform / analytic signal on top of WDLFFT::real_fft
+ **
+ **  C++ wrapper (C)2024 DEMOS
+ **  GITHUB: https://github.com/mewza or Email: subband@protonmail.com
+ **  LICENSE: same as wdlfft.h
+ **
+ **  The analytic signal of a real x is z = x + i*H{x}. Its real part is
+ **  x itself, so only H{x} is computed, and that is a real signal:
+ **  H{x} = IDFT(-i*sgn(k)*X[k]). The block functions run real_fft, turn
+ **  every packed bin (a+ib) into (b-ia) and zero DC and Nyquist, then run
+ **  the inverse real_fft: two len/2 complex transforms, against len/2
+ **  plus len for the usual real_fft, zero negative bins (walking
+ **  WDL_fft_permute) and a full complex inverse. The product is
+ **  elementwise, so the permuted order never has to be undone. Block
+ **  results are periodic (the signal wraps around), like
+ **  scipy.signal.hilbert.
+ **
+ **  For continuous input the same class streams through an FIR Hilbert
+ **  filter, h[n] = 2/(pi*n) for odd n, Blackman windowed, 2*taps+1 long,
+ **  applied by overlap-save: each block of len - 2*taps samples costs one
+ **  forward and one inverse real_fft of len and a packed complex
+ **  multiply. out[t] is the analytic signal of in[t - latency()], with
+ **  latency() = taps + block(): one block of buffering plus the filter's
+ **  delay. The magnitude response is flat within 1e-3 from about
+ **  3 / (2*taps) to 0.5 - 3 / (2*taps) cycles per sample.
+ **
+ **  T may be a vector type, each lane an independent channel.
+ */
+
+#pragma once
+
+#include "wdlfft.h"
+
+template <typename T>
+class WDLFFT_Hilbert {
+public:
+
+    /*
+     * h[0..len-1] = H{x}, h may be x. Returns 0, or -1 without touching h
+     * if len is not a power of two in 4..32768.
+     */
+    static int32_t hilbert(const T *x, T *h, int32_t len)
+    {
+        const int32_t half = len / 2;
+        const T scale = (T)(0.5 / len);
+        cmplxT<T> *s = (cmplxT<T> *) h;
+        int32_t i;
+
+        if (!block_len_ok(len) || !h) return -1;
+
+        WDLFFT<T>::WDL_fft_init();
+        if (h != x) memcpy(h, x, len * sizeof(T));
+        WDLFFT<T>::real_fft(h, len, 0);
+
+        // -i * (a + ib) = b - ia, with the inverse's 1/(2*len) folded in
+        s[0].re = s[0].im = 0;
+        for (i = 1; i < half; i ++)
+        {
+            const T re = s[i].re;
+            s[i].re = s[i].im * scale;
+            s[i].im = -re * scale;
+        }
+        WDLFFT<T>::real_fft(h, len, 1);
+        return 0;
+    }
+
+    /* z[0..len-1] = x + i*H{x}; 0, or -1 (z untouched) for a bad len or no scratch */
+    static int32_t analytic(const T *x, cmplxT<T> *z, int32_t len)
+    {
+        if (!block_len_ok(len)) return -1;
+
+        WDLFFT_Scratch scratch;
+        T *h = scratch.get<T>(len);
+        int32_t i;
+
+        if (hilbert(x, h, len) < 0) return -1;
+        for (i = 0; i < len; i ++)
+        {
+            z[i].re = x[i];
+            z[i].im = h[i];
+        }
+        return 0;
+    }
+
+    /* env[0..len-1] = |x + i*H{x}|, env may be x; 0 or -1 as analytic() */
+    static int32_t envelope(const T *x, T *env, int32_t len)
+    {
+        if (!block_len_ok(len)) return -1;
+
+        WDLFFT_Scratch scratch;
+        T *h = scratch.get<T>(len);
+        int32_t i;
+
+        if (hilbert(x, h, len) < 0) return -1;
+        for (i = 0; i < len; i ++) env[i] = sqrt(x[i] * x[i] + h[i] * h[i]);
+        return 0;
+    }
+
+    WDLFFT_Hilbert() : m_len(0), m_taps(0), m_block(0), m_pos(0), m_filt(0), m_in(0), m_work(0), m_out(0) { }
+    ~WDLFFT_Hilbert() { free_bufs(); }
+
+    /*
+     * Streaming mode: len = transform size, a power of two in 16..32768,
+     * taps = one-sided filter length, 1 <= taps < len / 2 (len / 8 is a
+     * reasonable choice). Returns false otherwise.
+     */
+    bool init(int32_t len, int32_t taps)
+    {
+        int32_t i;
+        free_bufs();
+        if (len < 16 || len > (1 << FFT_MAXBITLEN) || (len & (len - 1)) || taps < 1 || 2 * taps >= len) return false;
+
+        WDLFFT<T>::WDL_fft_init();
+
+        m_len = len;
+        m_taps = taps;
+        m_block = len - 2 * taps;
+        m_filt = (T *) WDLFFT<T>::alloc_buffer(len / 2);
+        m_in = (T *) WDLFFT<T>::alloc_buffer(len / 2);
+        m_work = (T *) WDLFFT<T>::alloc_buffer(len / 2);
+        m_out = WDLFFT<T>::alloc_buffer(m_block);
+
+        // causal FIR, delay taps; packed spectrum / (4*len) so the
+        // product needs no further scaling after the inverse
+        memset(m_filt, 0, len * sizeof(T));
+        for (i = 1; i <= taps; i += 2)
+        {
+            const double a = 2.0 * M_PI * (i + taps) / (2 * taps);
+            const double w = 0.42 - 0.5 * cos(a) + 0.08 * cos(2 * a);
+            const double v = 2.0 / (M_PI * i) * w / (4.0 * len);
+            m_filt[taps + i] = (T) v;
+            m_filt[taps - i] = (T) -v;
+        }
+        WDLFFT<T>::real_fft(m_filt, len, 0);
+
+        reset();
+        return true;
+    }
+
+    /* zero history */
+    void reset()
+    {
+        if (!m_len) return;
+        memset(m_in, 0, m_len * sizeof(T));
+        memset(m_out, 0, m_block * sizeof(cmplxT<T>));
+        m_pos = 0;
+    }
+
+    int32_t block() const { return m_block; }
+    int32_t latency() const { return m_taps + m_block; }
+
+    /* out[0..n-1] = analytic signal of the input latency() samples earlier */
+    void process(const T *in, cmplxT<T> *out, int32_t n)
+    {
+        const int32_t hist = m_len - m_block;
+        int32_t i;
+        while (n > 0)
+        {
+            int32_t c = m_block - m_pos;
+            if (c > n) c = n;
+
+            for (i = 0; i < c; i ++) out[i] = m_out[m_pos + i];
+            memcpy(m_in + hist + m_pos, in, c * sizeof(T));
+            m_pos += c;
+            in += c;
+            out += c;
+            n -= c;
+
+            if (m_pos == m_block)
+            {
+                run_block();
+                memmove(m_in, m_in + m_block, hist * sizeof(T));
+                m_pos = 0;
+            }
+        }
+    }
+
+private:
+
+    // owns the filter, history, work and output buffers
+    WDLFFT_Hilbert(const WDLFFT_Hilbert &);
+    WDLFFT_Hilbert &operator=(const WDLFFT_Hilbert &);
+
+    static bool block_len_ok(int32_t len)
+    {
+        return len >= 4 && len <= (1 << FFT_MAXBITLEN) && !(len & (len - 1));
+    }
+
+    /* overlap-save: the last block() outputs of m_in convolved with the FIR */
+    void run_block()
+    {
+        const int32_t half = m_len / 2, hist = m_len - m_block;
+        const cmplxT<T> *f = (const cmplxT<T> *) m_filt;
+        cmplxT<T> *s = (cmplxT<T> *) m_work;
+        int32_t i;
+
+        memcpy(m_work, m_in, m_len * sizeof(T));
+        WDLFFT<T>::real_fft(m_work, m_len, 0);
+
+        // packed product: DC and Nyquist are real and share [0]
+        s[0].re *= f[0].re;
+        s[0].im *= f[0].im;
+        for (i = 1; i < half; i ++)
+        {
+            const T re = s[i].re * f[i].re - s[i].im * f[i].im;
+            s[i].im = s[i].re * f[i].im + s[i].im * f[i].re;
+            s[i].re = re;
+        }
+        WDLFFT<T>::real_fft(m_work, m_len, 1);
+
+        // the first hist outputs wrap around; the rest are valid, delayed by m_taps
+        for (i = 0; i < m_block; i ++)
+        {
+            m_out[i].re = m_in[hist + i - m_taps];
+            m_out[i].im = m_work[hist + i];
+        }
+    }
+
+    void free_bufs()
+    {
+        WDLFFT<T>::free_buffer(m_filt);
+        WDLFFT<T>::free_buffer(m_in);
+        WDLFFT<T>::free_buffer(m_work);
+        WDLFFT<T>::free_buffer(m_out);
+        m_filt = m_in = m_work = 0;
+        m_out = 0;
+        m_len = 0;
+    }
+
+    int32_t m_len, m_taps, m_block, m_pos;
+    T *m_filt;                  // packed FIR spectrum
+    T *m_in;                    // last len input samples
+    T *m_work;
+    cmplxT<T> *m_out;           // current output block
+};
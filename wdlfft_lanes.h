@@ -0,0 +1,250 @@
+/*
+ **  Lane packing for running WDLFFT<vector> over planar scalar channels
+ **
+ **  C++ wrapper (C)2024 DEMOS
+ **  GITHUB: https://github.com/mewza or Email: subband@protonmail.com
+ **  LICENSE: same as wdlfft.h
+ **
+ **  WDLFFT_Lanes<T, S> moves data between nch planar S buffers and an
+ **  array of T = vector of L = sizeof(T)/sizeof(S) lanes of S, lane c
+ **  holding channel c. The data is transposed in LxL register tiles:
+ **
+ **    float  x 8   AVX 8x8, or four NEON 4x4
+ **    float  x 16  four 8x8 tiles
+ **    double x 4   AVX 4x4
+ **    double x 8   four 4x4 tiles
+ **
+ **  anything else falls back to a scalar tile. Channel counts that are
+ **  not a multiple of L are handled with masked lanes: missing input
+ **  channels read as zero and their lanes are never written back.
+ */
+
+#pragma once
+
+#include "wdlfft.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+template <typename T, typename S = float>
+class WDLFFT_Lanes {
+public:
+
+    static const int32_t L = (int32_t)(sizeof(T) / sizeof(S));
+
+    /* dst[i] lane c = ch[c][i] for c < nch, 0 for nch <= c < L; nch <= L */
+    static void interleave(T *dst, const S * const *ch, int32_t nch, int32_t len)
+    {
+        const S *rows[L];
+        S *out = (S *)dst;
+        int32_t i, c;
+
+        for (i = 0; i + L <= len; i += L)
+        {
+            for (c = 0; c < L; c ++) rows[c] = c < nch ? ch[c] + i : zeros();
+            transpose_tile(rows, out + (size_t) i * L);
+        }
+        for (; i < len; i ++)
+            for (c = 0; c < L; c ++) out[(size_t) i * L + c] = c < nch ? ch[c][i] : 0;
+    }
+
+    /* ch[c][i] = src[i] lane c for c < nch; nch <= L */
+    static void deinterleave(S * const *ch, const T *src, int32_t nch, int32_t len)
+    {
+        const S *in = (const S *)src;
+        const S *rows[L];
+        S tile[L * L];
+        int32_t i, c, r;
+
+        for (i = 0; i + L <= len; i += L)
+        {
+            for (r = 0; r < L; r ++) rows[r] = in + (size_t)(i + r) * L;
+            transpose_tile(rows, tile);
+            for (c = 0; c < nch; c ++) memcpy(ch[c] + i, tile + c * L, L * sizeof(S));
+        }
+        for (; i < len; i ++)
+            for (c = 0; c < nch; c ++) ch[c][i] = in[(size_t) i * L + c];
+    }
+
+    /*
+     * Runs WDLFFT<T>::real_fft over nch planar channels in place, L at a
+     * time. Each channel ends up as WDLFFT<S>::real_fft would
+     * leave it (same scaling, packing and permuted order). work must
+     * hold len elements of T.
+     */
+    static void real_fft_multichannel(S * const *channels, int32_t nch, int32_t len, int32_t isInverse, T *work)
+    {
+        int32_t c;
+        for (c = 0; c < nch; c += L)
+        {
+            const int32_t n = nch - c < L ? nch - c : L;
+            interleave(work, channels + c, n, len);
+            WDLFFT<T>::real_fft(work, len, isInverse);
+            deinterleave(channels + c, work, n, len);
+        }
+    }
+
+    /* same, with the work buffer taken from the thread's WDLFFT_Arena */
+    static void real_fft_multichannel(S * const *channels, int32_t nch, int32_t len, int32_t isInverse)
+    {
+        WDLFFT_Scratch scratch;
+        real_fft_multichannel(channels, nch, len, isInverse, scratch.get<T>(len));
+    }
+
+    /* same for complex planar channels, each cmplxT<S>[len] */
+    static void fft_multichannel(cmplxT<S> * const *channels, int32_t nch, int32_t len, int32_t isInverse, cmplxT<T> *work)
+    {
+        S *rows[L];
+        int32_t c, l;
+        for (c = 0; c < nch; c += L)
+        {
+            const int32_t n = nch - c < L ? nch - c : L;
+
+            // cmplxT<S>[len] is S[2*len] with re/im alternating, and cmplxT<T>[len]
+            // is T[2*len] with re/im alternating, so the same transpose applies
+            for (l = 0; l < n; l ++) rows[l] = (S *)channels[c + l];
+            interleave((T *)work, rows, n, 2 * len);
+            WDLFFT<T>::fft(work, len, isInverse);
+            deinterleave(rows, (const T *)work, n, 2 * len);
+        }
+    }
+
+    static void fft_multichannel(cmplxT<S> * const *channels, int32_t nch, int32_t len, int32_t isInverse)
+    {
+        WDLFFT_Scratch scratch;
+        fft_multichannel(channels, nch, len, isInverse, scratch.get< cmplxT<T> >(len));
+    }
+
+private:
+
+    static const S *zeros()
+    {
+        static const S z[L] = { 0 };
+        return z;
+    }
+
+    /* dst[c*L + r] = rows[r][c] */
+    static void transpose_tile(const S * const *rows, S *dst)
+    {
+        tile(rows, dst, (S *)0);
+    }
+
+    template <typename X>
+    static void tile(const X * const *rows, X *dst, X *)
+    {
+        int32_t r, c;
+        for (r = 0; r < L; r ++)
+            for (c = 0; c < L; c ++) dst[c * L + r] = rows[r][c];
+    }
+
+    static void tile(const float * const *rows, float *dst, float *)
+    {
+        if (L == 8) t8x8(rows, dst, 8);
+        else if (L == 16)
+        {
+            const float *r2[16];
+            int32_t i;
+            for (i = 0; i < 16; i ++) r2[i] = rows[i] + 8;
+            t8x8(rows, dst, 16);            // rows 0-7,  cols 0-7
+            t8x8(rows + 8, dst + 8, 16);    // rows 8-15, cols 0-7
+            t8x8(r2, dst + 128, 16);        // rows 0-7,  cols 8-15
+            t8x8(r2 + 8, dst + 136, 16);    // rows 8-15, cols 8-15
+        }
+        else tile<float>(rows, dst, (float *)0);
+    }
+
+    static void tile(const double * const *rows, double *dst, double *)
+    {
+        if (L == 4) t4x4d(rows, dst, 4);
+        else if (L == 8)
+        {
+            const double *r2[8];
+            int32_t i;
+            for (i = 0; i < 8; i ++) r2[i] = rows[i] + 4;
+            t4x4d(rows, dst, 8);
+            t4x4d(rows + 4, dst + 4, 8);
+            t4x4d(r2, dst + 32, 8);
+            t4x4d(r2 + 4, dst + 36, 8);
+        }
+        else tile<double>(rows, dst, (double *)0);
+    }
+
+    /* 8 rows of 8 floats -> 8 rows of 8 floats, output row stride ds */
+    static void t8x8(const float * const *rows, float *dst, int32_t ds)
+    {
+#if defined(__AVX__)
+        __m256 r0 = _mm256_loadu_ps(rows[0]), r1 = _mm256_loadu_ps(rows[1]);
+        __m256 r2 = _mm256_loadu_ps(rows[2]), r3 = _mm256_loadu_ps(rows[3]);
+        __m256 r4 = _mm256_loadu_ps(rows[4]), r5 = _mm256_loadu_ps(rows[5]);
+        __m256 r6 = _mm256_loadu_ps(rows[6]), r7 = _mm256_loadu_ps(rows[7]);
+        __m256 t0, t1, t2, t3, t4, t5, t6, t7;
+
+        t0 = _mm256_unpacklo_ps(r0, r1);
+        t1 = _mm256_unpackhi_ps(r0, r1);
+        t2 = _mm256_unpacklo_ps(r2, r3);
+        t3 = _mm256_unpackhi_ps(r2, r3);
+        t4 = _mm256_unpacklo_ps(r4, r5);
+        t5 = _mm256_unpackhi_ps(r4, r5);
+        t6 = _mm256_unpacklo_ps(r6, r7);
+        t7 = _mm256_unpackhi_ps(r6, r7);
+
+        r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1,0,1,0));
+        r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3,2,3,2));
+        r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1,0,1,0));
+        r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3,2,3,2));
+        r4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1,0,1,0));
+        r5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3,2,3,2));
+        r6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1,0,1,0));
+        r7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3,2,3,2));
+
+        _mm256_storeu_ps(dst + 0 * ds, _mm256_permute2f128_ps(r0, r4, 0x20));
+        _mm256_storeu_ps(dst + 1 * ds, _mm256_permute2f128_ps(r1, r5, 0x20));
+        _mm256_storeu_ps(dst + 2 * ds, _mm256_permute2f128_ps(r2, r6, 0x20));
+        _mm256_storeu_ps(dst + 3 * ds, _mm256_permute2f128_ps(r3, r7, 0x20));
+        _mm256_storeu_ps(dst + 4 * ds, _mm256_permute2f128_ps(r0, r4, 0x31));
+        _mm256_storeu_ps(dst + 5 * ds, _mm256_permute2f128_ps(r1, r5, 0x31));
+        _mm256_storeu_ps(dst + 6 * ds, _mm256_permute2f128_ps(r2, r6, 0x31));
+        _mm256_storeu_ps(dst + 7 * ds, _mm256_permute2f128_ps(r3, r7, 0x31));
+#elif defined(__ARM_NEON)
+        int32_t br, bc;
+        for (br = 0; br < 8; br += 4)
+            for (bc = 0; bc < 8; bc += 4)
+            {
+                float32x4x2_t a = vtrnq_f32(vld1q_f32(rows[br + 0] + bc), vld1q_f32(rows[br + 1] + bc));
+                float32x4x2_t b = vtrnq_f32(vld1q_f32(rows[br + 2] + bc), vld1q_f32(rows[br + 3] + bc));
+                float *d = dst + bc * ds + br;
+                vst1q_f32(d + 0 * ds, vcombine_f32(vget_low_f32(a.val[0]), vget_low_f32(b.val[0])));
+                vst1q_f32(d + 1 * ds, vcombine_f32(vget_low_f32(a.val[1]), vget_low_f32(b.val[1])));
+                vst1q_f32(d + 2 * ds, vcombine_f32(vget_high_f32(a.val[0]), vget_high_f32(b.val[0])));
+                vst1q_f32(d + 3 * ds, vcombine_f32(vget_high_f32(a.val[1]), vget_high_f32(b.val[1])));
+            }
+#else
+        int32_t r, c;
+        for (r = 0; r < 8; r ++)
+            for (c = 0; c < 8; c ++) dst[c * ds + r] = rows[r][c];
+#endif
+    }
+
+    /* 4 rows of 4 doubles -> 4 rows of 4 doubles, output row stride ds */
+    static void t4x4d(const double * const *rows, double *dst, int32_t ds)
+    {
+#if defined(__AVX__)
+        const __m256d r0 = _mm256_loadu_pd(rows[0]), r1 = _mm256_loadu_pd(rows[1]);
+        const __m256d r2 = _mm256_loadu_pd(rows[2]), r3 = _mm256_loadu_pd(rows[3]);
+        const __m256d t0 = _mm256_unpacklo_pd(r0, r1), t1 = _mm256_unpackhi_pd(r0, r1);
+        const __m256d t2 = _mm256_unpacklo_pd(r2, r3), t3 = _mm256_unpackhi_pd(r2, r3);
+
+        _mm256_storeu_pd(dst + 0 * ds, _mm256_permute2f128_pd(t0, t2, 0x20));
+        _mm256_storeu_pd(dst + 1 * ds, _mm256_permute2f128_pd(t1, t3, 0x20));
+        _mm256_storeu_pd(dst + 2 * ds, _mm256_permute2f128_pd(t0, t2, 0x31));
+        _mm256_storeu_pd(dst + 3 * ds, _mm256_permute2f128_pd(t1, t3, 0x31));
+#else
+        int32_t r, c;
+        for (r = 0; r < 4; r ++)
+            for (c = 0; c < 4; c ++) dst[c * ds + r] = rows[r][c];
+#endif
+    }
+};
@@ -0,0 +1,194 @@
+/*
+ **  2D / 3D FFT on top of WDLFFT
+ **
+ **  C++ wrapper (C)2024 DEMOS
+ **  GITHUB: https://github.com/mewza or Email: subband@protonmail.com
+ **  LICENSE: same as wdlfft.h
+ **
+ **  Data is row-major, x fastest. Every axis length is a power of two,
+ **  1 <= len <= 32768 (an axis of length 1 is left alone); the calls
+ **  return 0, or -1 without touching buf for any other length. Rows run
+ **  through WDLFFT<T>::fft in place; the strided axes are done in
+ **  panels: a few columns are copied into a small scratch buffer (a
+ **  cache-blocked transpose that touches whole cache lines per row),
+ **  transformed, and copied back. Scratch comes from the calling thread's
+ **  WDLFFT_Arena, so one instance can serve several threads.
+ **
+ **  With V != T, T must be the scalar of the vector type V (for example
+ **  WDLFFT_ND<float, simd_float8>); the strided passes then gather
+ **  sizeof(V)/sizeof(T) columns straight into the lanes of one
+ **  cmplxT<V> column and run WDLFFT<V>::fft once for all of them. A
+ **  ragged last group zero-fills the unused lanes. WDLFFT<V> needs its
+ **  own DECL_WDLFFT.
+ **
+ **  Output, like WDLFFT<T>::fft, is unnormalized and in WDL_fft_permute
+ **  order along every axis: X[ky][kx] lands at
+ **  [WDL_fft_permute(ny,ky)][WDL_fft_permute(nx,kx)]. The inverse takes
+ **  that layout and returns natural order; scale by 1.0/(nx*ny*nz).
+ **
+ **  The real-input versions run real_fft on the rows (nx reals become
+ **  nx/2 packed complex bins, Nyquist in [0].im, see real_fft) and
+ **  complex passes on the other axes. Column 0 then holds the kx=0 and
+ **  kx=nx/2 planes packed as Z = A + i*B of two real signals. The inverse
+ **  takes the same layout; scale by 0.5/(nx*ny*nz).
+ */
+
+#pragma once
+
+#include "wdlfft.h"
+
+template <typename T, typename V = T>
+class WDLFFT_ND {
+public:
+
+    static const int32_t LANES = (int32_t)(sizeof(V) / sizeof(T));
+    static const int32_t PANEL = sizeof(cmplxT<T>) >= 256 ? 1 : (int32_t)(256 / sizeof(cmplxT<T>));
+
+    int32_t fft2d(cmplxT<T> *buf, int32_t ny, int32_t nx, int32_t isInverse)
+    {
+        return fft3d(buf, 1, ny, nx, isInverse);
+    }
+
+    int32_t real_fft2d(T *buf, int32_t ny, int32_t nx, int32_t isInverse)
+    {
+        return real_fft3d(buf, 1, ny, nx, isInverse);
+    }
+
+    int32_t fft3d(cmplxT<T> *buf, int32_t nz, int32_t ny, int32_t nx, int32_t isInverse)
+    {
+        int32_t r;
+        if (!valid(nz) || !valid(ny) || !valid(nx)) return -1;
+        init_tabs();
+
+        if (!isInverse && nx > 1)
+            for (r = 0; r < nz * ny; r ++) WDLFFT<T>::fft(buf + (size_t) r * nx, nx, 0);
+
+        strided_passes(buf, nz, ny, nx, isInverse);
+
+        if (isInverse && nx > 1)
+            for (r = 0; r < nz * ny; r ++) WDLFFT<T>::fft(buf + (size_t) r * nx, nx, 1);
+        return 0;
+    }
+
+    int32_t real_fft3d(T *buf, int32_t nz, int32_t ny, int32_t nx, int32_t isInverse)
+    {
+        int32_t r;
+        if (!valid(nz) || !valid(ny) || nx < 4 || !valid(nx)) return -1;
+        init_tabs();
+
+        const int32_t half = nx >> 1;
+        if (!isInverse)
+            for (r = 0; r < nz * ny; r ++) WDLFFT<T>::real_fft(buf + (size_t) r * nx, nx, 0);
+
+        strided_passes((cmplxT<T> *)buf, nz, ny, half, isInverse);
+
+        if (isInverse)
+            for (r = 0; r < nz * ny; r ++) WDLFFT<T>::real_fft(buf + (size_t) r * nx, nx, 1);
+        return 0;
+    }
+
+    /*
+     * Transforms cols columns of rows elements each, column c starting at
+     * buf[c] with a stride of stride elements. This is the strided pass
+     * used above, exposed for other layouts.
+     */
+    void column_pass(cmplxT<T> *buf, int32_t rows, int32_t cols, int32_t stride, int32_t isInverse)
+    {
+        WDLFFT_Scratch scratch;
+        int32_t c;
+        if (rows < 2) return;
+
+        if (LANES > 1)
+        {
+            cmplxT<V> *col = scratch.get< cmplxT<V> >(rows);
+            for (c = 0; c < cols; c += LANES)
+            {
+                const int32_t nl = cols - c < LANES ? cols - c : LANES;
+                gather_lanes(col, buf + c, rows, stride, nl);
+                WDLFFT<V>::fft(col, rows, isInverse);
+                scatter_lanes(buf + c, col, rows, stride, nl);
+            }
+        } else
+        {
+            cmplxT<T> *panel = scratch.get< cmplxT<T> >(rows * PANEL);
+            for (c = 0; c < cols; c += PANEL)
+            {
+                const int32_t nc = cols - c < PANEL ? cols - c : PANEL;
+                int32_t j;
+                transpose_in(panel, buf + c, rows, stride, nc);
+                for (j = 0; j < nc; j ++) WDLFFT<T>::fft(panel + j * rows, rows, isInverse);
+                transpose_out(buf + c, panel, rows, stride, nc);
+            }
+        }
+    }
+
+private:
+
+    static bool valid(int32_t n)
+    {
+        return n >= 1 && n <= (1 << FFT_MAXBITLEN) && !(n & (n - 1));
+    }
+
+    static void init_tabs()
+    {
+        WDLFFT<T>::WDL_fft_init();
+        if (LANES > 1) WDLFFT<V>::WDL_fft_init();
+    }
+
+    void strided_passes(cmplxT<T> *buf, int32_t nz, int32_t ny, int32_t nx, int32_t isInverse)
+    {
+        int32_t z;
+        const int32_t plane = ny * nx;
+
+        // forward goes y then z, inverse z then y; both orders commute, this
+        // just mirrors the row pass so the whole transform is symmetric
+        if (isInverse) column_pass(buf, nz, plane, plane, 1);
+        for (z = 0; z < nz; z ++) column_pass(buf + (size_t) z * plane, ny, nx, nx, isInverse);
+        if (!isInverse) column_pass(buf, nz, plane, plane, 0);
+    }
+
+    /* panel[j*rows + r] = src[r*stride + j], j < nc */
+    static void transpose_in(cmplxT<T> *panel, const cmplxT<T> *src, int32_t rows, int32_t stride, int32_t nc)
+    {
+        int32_t r, j;
+        for (r = 0; r < rows; r ++, src += stride)
+            for (j = 0; j < nc; j ++) panel[j * rows + r] = src[j];
+    }
+
+    static void transpose_out(cmplxT<T> *dest, const cmplxT<T> *panel, int32_t rows, int32_t stride, int32_t nc)
+    {
+        int32_t r, j;
+        for (r = 0; r < rows; r ++, dest += stride)
+            for (j = 0; j < nc; j ++) dest[j] = panel[j * rows + r];
+    }
+
+    /* lane l of col[r] = src[r*stride + l], l < nl, other lanes zero */
+    static void gather_lanes(cmplxT<V> *col, const cmplxT<T> *src, int32_t rows, int32_t stride, int32_t nl)
+    {
+        int32_t r, l;
+        for (r = 0; r < rows; r ++, src += stride)
+        {
+            T *re = (T *)&col[r].re, *im = (T *)&col[r].im;
+            for (l = 0; l < nl; l ++)
+            {
+                re[l] = src[l].re;
+                im[l] = src[l].im;
+            }
+            for (; l < LANES; l ++) re[l] = im[l] = 0;
+        }
+    }
+
+    static void scatter_lanes(cmplxT<T> *dest, const cmplxT<V> *col, int32_t rows, int32_t stride, int32_t nl)
+    {
+        int32_t r, l;
+        for (r = 0; r < rows; r ++, dest += stride)
+        {
+            const T *re = (const T *)&col[r].re, *im = (const T *)&col[r].im;
+            for (l = 0; l < nl; l ++)
+            {
+                dest[l].re = re[l];
+                dest[l].im = im[l];
+            }
+        }
+    }
+};
@@ -0,0 +1,342 @@
+/*
+ **  Real-time to worker FFT offload on top of WDLFFT::real_fft
+ **
+ **  C++ wrapper (C)2024 DEMOS
+ **  GITHUB: https://github.com/mewza or Email: subband@protonmail.com
+ **  LICENSE: same as wdlfft.h
+ **
+ **  WDLFFT_Offload<T> moves STFT processing off the audio thread. The
+ **  audio thread calls process() with any block size up to max_block. It
+ **  copies the input into a single-producer/single-consumer ring and takes
+ **  the same number of output samples from a second ring: a few memcpys
+ **  and atomic loads/stores, no locks, no allocation, no system calls,
+ **  wait-free. A worker thread (start(), or your own thread calling
+ **  work()) pops hop samples at a time. For each hop it runs a sqrt-Hann
+ **  windowed real_fft of len samples, calls the spectral processor on the
+ **  packed spectrum, then runs the inverse and overlap-adds. It pushes
+ **  hop samples back.
+ **
+ **  The output ring starts with hop + slack + max_block - 1 zeros, so
+ **  out[t] is the processed in[t - latency()], latency() = len + slack +
+ **  max_block - 1 samples. The max_block - 1 covers block sizes that do
+ **  not divide the hop: a hop can complete only on the last sample of one
+ **  audio block while the next call already needs up to max_block of its
+ **  output. With that, a worker that runs every ready hop before each
+ **  process() never underruns, and slack is its time budget on top, in
+ **  samples. If it is late anyway, the missing output is played as zeros and
+ **  the late samples are skipped when they arrive. If the input ring is
+ **  full, zeros are queued in place of the lost input. Either way the
+ **  latency never drifts; underruns() and overruns() count the events.
+ **
+ **  T may be a vector type, each lane an independent channel.
+ */
+
+#pragma once
+
+#include "wdlfft.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+/*
+ * Wait-free single-producer/single-consumer ring of T. One thread only
+ * writes, one thread only reads; the indices run free (uint32_t, wrap
+ * is harmless for capacities up to 2^31) and read / write keep a copy
+ * of the other side's index, touching its cache line only when the
+ * copy shows too little data or room.
+ */
+template <typename T>
+class WDLFFT_SPSC {
+public:
+
+    WDLFFT_SPSC() : m_buf(0), m_mask(0), m_head(0), m_tail(0), m_tail_cache(0), m_head_cache(0) { }
+    ~WDLFFT_SPSC() { WDL_fft_aligned_free(m_buf); }
+
+    /* capacity rounded up to a power of two, at most 2^30; not real-time safe */
+    bool init(int32_t capacity)
+    {
+        uint32_t c = 1;
+        WDL_fft_aligned_free(m_buf);
+        m_buf = 0;
+        m_mask = 0;
+        if (capacity < 1 || capacity > (1 << 30)) return false;
+        while (c < (uint32_t) capacity) c <<= 1;
+        m_buf = (T *) WDL_fft_aligned_alloc(c * sizeof(T));
+        if (!m_buf) return false;
+        m_mask = c - 1;
+        reset();
+        return true;
+    }
+
+    /* empties the ring; only while neither side is using it */
+    void reset()
+    {
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+        m_tail_cache = m_head_cache = 0;
+    }
+
+    int32_t capacity() const { return (int32_t)(m_mask + 1); }
+
+    /* producer side: free slots right now */
+    int32_t write_available()
+    {
+        m_tail_cache = m_tail.load(std::memory_order_acquire);
+        return (int32_t)(m_mask + 1 - (m_head.load(std::memory_order_relaxed) - m_tail_cache));
+    }
+
+    /* copies up to n values from src (zeros if src is 0), returns how many */
+    int32_t write(const T *src, int32_t n)
+    {
+        const uint32_t head = m_head.load(std::memory_order_relaxed);
+        if ((uint32_t) n > m_mask + 1 - (head - m_tail_cache)) m_tail_cache = m_tail.load(std::memory_order_acquire);
+        const uint32_t room = m_mask + 1 - (head - m_tail_cache);
+        if ((uint32_t) n > room) n = (int32_t) room;
+        if (n <= 0) return 0;
+
+        const uint32_t at = head & m_mask, first = m_mask + 1 - at < (uint32_t) n ? m_mask + 1 - at : (uint32_t) n;
+        if (src)
+        {
+            memcpy(m_buf + at, src, first * sizeof(T));
+            memcpy(m_buf, src + first, (n - first) * sizeof(T));
+        } else
+        {
+            memset(m_buf + at, 0, first * sizeof(T));
+            memset(m_buf, 0, (n - first) * sizeof(T));
+        }
+        m_head.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    /* consumer side: values ready right now */
+    int32_t read_available()
+    {
+        m_head_cache = m_head.load(std::memory_order_acquire);
+        return (int32_t)(m_head_cache - m_tail.load(std::memory_order_relaxed));
+    }
+
+    /* moves up to n values to dst (drops them if dst is 0), returns how many */
+    int32_t read(T *dst, int32_t n)
+    {
+        const uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        if ((uint32_t) n > m_head_cache - tail) m_head_cache = m_head.load(std::memory_order_acquire);
+        const uint32_t avail = m_head_cache - tail;
+        if ((uint32_t) n > avail) n = (int32_t) avail;
+        if (n <= 0) return 0;
+
+        if (dst)
+        {
+            const uint32_t at = tail & m_mask, first = m_mask + 1 - at < (uint32_t) n ? m_mask + 1 - at : (uint32_t) n;
+            memcpy(dst, m_buf + at, first * sizeof(T));
+            memcpy(dst + first, m_buf, (n - first) * sizeof(T));
+        }
+        m_tail.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+private:
+
+    WDLFFT_SPSC(const WDLFFT_SPSC &);
+    WDLFFT_SPSC &operator=(const WDLFFT_SPSC &);
+
+    T *m_buf;
+    uint32_t m_mask;
+    alignas(64) std::atomic<uint32_t> m_head;   // written by the producer
+    alignas(64) std::atomic<uint32_t> m_tail;   // written by the consumer
+    alignas(64) uint32_t m_tail_cache;          // producer's copy of m_tail
+    alignas(64) uint32_t m_head_cache;          // consumer's copy of m_head
+};
+
+template <typename T>
+class WDLFFT_Offload {
+public:
+
+    /*
+     * Runs on the worker, once per hop. spec[0..len/2-1] is the packed
+     * real_fft spectrum of the windowed frame: bin k at
+     * WDL_fft_permute_tab(len/2)[k] for 0 < k < len/2, DC in spec[0].re,
+     * Nyquist in spec[0].im. Left untouched, the input passes through
+     * unchanged apart from the delay.
+     */
+    typedef void (*processor_t)(void *ctx, cmplxT<T> *spec, int32_t len);
+
+    WDLFFT_Offload() : m_len(0), m_hop(0), m_slack(0), m_max_block(0), m_proc(0), m_ctx(0), m_owed(0), m_in_owed(0),
+                       m_awin(0), m_swin(0), m_hist(0), m_work(0), m_ola(0),
+                       m_underruns(0), m_overruns(0), m_frames(0), m_quit(false) { }
+    ~WDLFFT_Offload() { stop(); free_bufs(); }
+
+    /*
+     * len = frame size, a power of two in 16..32768; hop divides len and
+     * is at most len/2. max_block is the largest n process() will see.
+     * slack >= 0 is the worker's time budget, in samples, beyond the
+     * max_block - 1 that block alignment already costs (see latency()). proc may be 0 (plain delay). Returns false on bad arguments.
+     * Not real-time safe; call while the worker is stopped.
+     */
+    bool init(int32_t len, int32_t hop, int32_t slack, int32_t max_block, processor_t proc, void *ctx)
+    {
+        int32_t i;
+        stop();
+        free_bufs();
+        if (len < 16 || len > (1 << FFT_MAXBITLEN) || (len & (len - 1)) || hop < 1 || hop > len / 2 || len % hop ||
+            slack < 0 || max_block < 1) return false;
+
+        WDLFFT<T>::WDL_fft_init();
+
+        m_len = len;
+        m_hop = hop;
+        m_slack = slack;
+        m_max_block = max_block;
+        m_proc = proc;
+        m_ctx = ctx;
+        m_awin = (T *) WDLFFT<T>::alloc_buffer(len / 2);
+        m_swin = (T *) WDLFFT<T>::alloc_buffer(len / 2);
+        m_hist = (T *) WDLFFT<T>::alloc_buffer(len / 2);
+        m_work = (T *) WDLFFT<T>::alloc_buffer(len / 2);
+        m_ola = (T *) WDLFFT<T>::alloc_buffer(len / 2);
+
+        // sqrt-Hann both ways: Hann at hop sums to len/(2*hop), the real_fft roundtrip gain is 2*len
+        const double g = 2.0 * hop / len / (2.0 * len);
+        for (i = 0; i < len; i ++)
+        {
+            const double w = sqrt(0.5 - 0.5 * cos(2.0 * M_PI * i / len));
+            m_awin[i] = (T) w;
+            m_swin[i] = (T)(w * g);
+        }
+
+        // the output ring holds the prefill, a block in flight and what the worker may run ahead
+        const int32_t cap = 2 * (len + slack + max_block);
+        if (!m_inq.init(cap) || !m_outq.init(cap))
+        {
+            free_bufs();
+            return false;
+        }
+        reset();
+        return true;
+    }
+
+    /* zero history and queues; only while the worker is stopped */
+    void reset()
+    {
+        if (!m_len) return;
+        memset(m_hist, 0, m_len * sizeof(T));
+        memset(m_ola, 0, m_len * sizeof(T));
+        m_inq.reset();
+        m_outq.reset();
+        m_outq.write(0, m_hop + m_slack + m_max_block - 1);
+        m_owed = m_in_owed = 0;
+        m_underruns.store(0, std::memory_order_relaxed);
+        m_overruns.store(0, std::memory_order_relaxed);
+        m_frames.store(0, std::memory_order_relaxed);
+    }
+
+    /*
+     * Starts a worker thread that calls work() and sleeps idle_us
+     * microseconds whenever there is nothing to do; keep idle_us well
+     * under slack. Not real-time safe.
+     */
+    bool start(int32_t idle_us = 100)
+    {
+        if (!m_len || m_thread.joinable()) return false;
+        m_quit.store(false, std::memory_order_relaxed);
+        m_thread = std::thread([this, idle_us]()
+        {
+            while (!m_quit.load(std::memory_order_relaxed))
+            {
+                if (!work()) std::this_thread::sleep_for(std::chrono::microseconds(idle_us));
+            }
+        });
+        return true;
+    }
+
+    void stop()
+    {
+        if (!m_thread.joinable()) return;
+        m_quit.store(true, std::memory_order_relaxed);
+        m_thread.join();
+    }
+
+    int32_t frame_size() const { return m_len; }
+    int32_t hop() const { return m_hop; }
+    int32_t latency() const { return m_len + m_slack + m_max_block - 1; }
+
+    int64_t underruns() const { return m_underruns.load(std::memory_order_relaxed); }
+    int64_t overruns() const { return m_overruns.load(std::memory_order_relaxed); }
+    int64_t frames() const { return m_frames.load(std::memory_order_relaxed); }
+
+    /*
+     * Audio thread: queues in[0..n-1] and writes the output of
+     * in[t - latency()] to out[0..n-1]; n <= max_block, out may be in.
+     * Wait-free.
+     */
+    void process(const T *in, T *out, int32_t n)
+    {
+        // input: first the zeros owed for earlier overruns, then in
+        if (m_in_owed) m_in_owed -= m_inq.write(0, m_in_owed);
+        const int32_t w = m_in_owed ? 0 : m_inq.write(in, n);
+        if (w < n)
+        {
+            m_in_owed += n - w;
+            m_overruns.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // output: skip what came too late to play, zero what is missing
+        if (m_owed) m_owed -= m_outq.read(0, m_owed);
+        const int32_t r = m_owed ? 0 : m_outq.read(out, n);
+        if (r < n)
+        {
+            memset(out + r, 0, (n - r) * sizeof(T));
+            m_owed += n - r;
+            m_underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /* worker: runs every hop that is ready, returns how many */
+    int32_t work()
+    {
+        const int32_t keep = m_len - m_hop;
+        int32_t done = 0, i;
+
+        while (m_inq.read_available() >= m_hop && m_outq.write_available() >= m_hop)
+        {
+            memmove(m_hist, m_hist + m_hop, keep * sizeof(T));
+            m_inq.read(m_hist + keep, m_hop);
+
+            for (i = 0; i < m_len; i ++) m_work[i] = m_hist[i] * m_awin[i];
+            WDLFFT<T>::real_fft(m_work, m_len, 0);
+            if (m_proc) m_proc(m_ctx, (cmplxT<T> *) m_work, m_len);
+            WDLFFT<T>::real_fft(m_work, m_len, 1);
+            for (i = 0; i < m_len; i ++) m_ola[i] += m_work[i] * m_swin[i];
+
+            m_outq.write(m_ola, m_hop);
+            memmove(m_ola, m_ola + m_hop, keep * sizeof(T));
+            memset(m_ola + keep, 0, m_hop * sizeof(T));
+            m_frames.fetch_add(1, std::memory_order_relaxed);
+            done ++;
+        }
+        return done;
+    }
+
+private:
+
+    void free_bufs()
+    {
+        WDLFFT<T>::free_buffer(m_awin);
+        WDLFFT<T>::free_buffer(m_swin);
+        WDLFFT<T>::free_buffer(m_hist);
+        WDLFFT<T>::free_buffer(m_work);
+        WDLFFT<T>::free_buffer(m_ola);
+        m_awin = m_swin = m_hist = m_work = m_ola = 0;
+        m_len = 0;
+    }
+
+    int32_t m_len, m_hop, m_slack, m_max_block;
+    processor_t m_proc;
+    void *m_ctx;
+    int32_t m_owed, m_in_owed;              // audio thread only
+    T *m_awin, *m_swin;                     // sqrt-Hann; m_swin carries the OLA and roundtrip scaling
+    T *m_hist, *m_work, *m_ola;             // worker only
+    WDLFFT_SPSC<T> m_inq, m_outq;
+    std::atomic<int64_t> m_underruns, m_overruns, m_frames;
+    std::atomic<bool> m_quit;
+    std::thread m_thread;
+};
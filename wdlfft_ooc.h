@@ -0,0 +1,431 @@
+/*
+ **  Out-of-core four-step FFT over memory-mapped files
+ **
+ **  C++ wrapper (C)2024 DEMOS
+ **  GITHUB: https://github.com/mewza or Email: subband@protonmail.com
+ **  LICENSE: same as wdlfft.h
+ **
+ **  WDLFFT_OOC<T> transforms files too large for RAM: n = N1 * N2 complex
+ **  points, N1, N2 <= 32768, so up to 2^30 (8 GB of complex float, 16 GB
+ **  of complex double). The input file is mapped read-only and the
+ **  output file is mapped read-write; both hold raw T, native endian.
+ **  The output file doubles as the intermediate, so no temp file is
+ **  needed. Treating x as N1 rows of N2, the two passes are:
+ **
+ **    1  for each panel of P columns: gather (P runs of N2 stride),
+ **       N1-point WDLFFT<T>::fft per column, multiply by
+ **       exp(-2*pi*i*n2*k1/n), write column n2 contiguously to
+ **       out[n2*N1 + k1]
+ **    2  for each panel of P columns of that N2 x N1 matrix: gather,
+ **       N2-point fft per column, write X[k1 + N1*k2] = out[k2*N1 + k1]
+ **       back into the same columns
+ **
+ **  The sub-transform output is read through WDL_fft_permute_tab, so
+ **  the file ends up in natural order with no reorder pass. Twiddles
+ **  come from two tables of about sqrt(n) entries in double, one complex
+ **  multiply each, accurate to a few ulp at any n.
+ **
+ **  P is the largest power of two for which two panels fit in mem_bytes.
+ **  A panel reads runs of P * sizeof(cmplxT<T>) bytes, so mem_bytes
+ **  should keep that at a page or more; otherwise a dataset larger than
+ **  the page cache gets each page read once per panel that touches it.
+ **  The 256 MB default gives 4 KB runs at 2^28 complex float.
+ **  Panels are double-buffered: a reader thread gathers panel p+1
+ **  (this is where page faults do the disk reads) while the calling
+ **  thread transforms panel p and writes it out, so a disk-bound run
+ **  waits on the reads, not on the transforms.
+ **
+ **  Results are the plain DFT, X[k] = sum x[j] exp(-+2*pi*i*j*k/n),
+ **  unnormalized, in natural order. real_fft_file takes n real samples
+ **  and writes X[0..n/2] (n/2+1 complex). It runs the complex transform
+ **  on the samples as n/2 complex pairs, then one in-place split pass
+ **  that works inward from both ends of the output file.
+ **
+ **  T is float or double. Needs mmap (POSIX) or file mappings (Win32).
+ */
+
+#pragma once
+
+#include "wdlfft.h"
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* a whole file mapped into memory; size 0 for read-only opens it as is */
+class WDLFFT_MappedFile {
+public:
+
+    WDLFFT_MappedFile() : m_ptr(0), m_size(0)
+    {
+#ifdef _WIN32
+        m_file = m_map = 0;
+#else
+        m_fd = -1;
+#endif
+    }
+    ~WDLFFT_MappedFile() { close(); }
+
+    /* read-only if size == 0, otherwise created / resized to size bytes and writable */
+    bool open(const char *path, uint64_t size)
+    {
+        close();
+#ifdef _WIN32
+        const bool rw = size != 0;
+        m_file = CreateFileA(path, rw ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, 0,
+                             rw ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+        if (m_file == INVALID_HANDLE_VALUE) { m_file = 0; return false; }
+        if (rw)
+        {
+            LARGE_INTEGER li;
+            li.QuadPart = (LONGLONG) size;
+            if (!SetFilePointerEx(m_file, li, 0, FILE_BEGIN) || !SetEndOfFile(m_file)) { close(); return false; }
+        } else
+        {
+            LARGE_INTEGER li;
+            if (!GetFileSizeEx(m_file, &li)) { close(); return false; }
+            size = (uint64_t) li.QuadPart;
+        }
+        if (!size) { close(); return false; }
+        m_map = CreateFileMappingA(m_file, 0, rw ? PAGE_READWRITE : PAGE_READONLY, 0, 0, 0);
+        if (!m_map) { close(); return false; }
+        m_ptr = MapViewOfFile(m_map, rw ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+#else
+        const bool rw = size != 0;
+        m_fd = ::open(path, rw ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+        if (m_fd < 0) return false;
+        if (rw)
+        {
+            if (ftruncate(m_fd, (off_t) size)) { close(); return false; }
+        } else
+        {
+            struct stat st;
+            if (fstat(m_fd, &st)) { close(); return false; }
+            size = (uint64_t) st.st_size;
+        }
+        if (!size) { close(); return false; }
+        m_ptr = mmap(0, (size_t) size, rw ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, m_fd, 0);
+        if (m_ptr == MAP_FAILED) m_ptr = 0;
+#endif
+        if (!m_ptr) { close(); return false; }
+        m_size = size;
+        return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (m_ptr) UnmapViewOfFile(m_ptr);
+        if (m_map) CloseHandle(m_map);
+        if (m_file) CloseHandle(m_file);
+        m_file = m_map = 0;
+#else
+        if (m_ptr) munmap(m_ptr, (size_t) m_size);
+        if (m_fd >= 0) ::close(m_fd);
+        m_fd = -1;
+#endif
+        m_ptr = 0;
+        m_size = 0;
+    }
+
+    void *data() const { return m_ptr; }
+    uint64_t size() const { return m_size; }
+
+private:
+
+    // owns the mapping and the file handles
+    WDLFFT_MappedFile(const WDLFFT_MappedFile &);
+    WDLFFT_MappedFile &operator=(const WDLFFT_MappedFile &);
+
+    void *m_ptr;
+    uint64_t m_size;
+#ifdef _WIN32
+    HANDLE m_file, m_map;
+#else
+    int m_fd;
+#endif
+};
+
+template <typename T>
+class WDLFFT_OOC {
+public:
+
+    enum { MAX_LOG2 = 2 * FFT_MAXBITLEN, TILE = 32 };
+
+    /*
+     * in_path holds n cmplxT<T>, out_path is created with n cmplxT<T>.
+     * n a power of two in 4..2^30. mem_bytes bounds the two panel
+     * buffers. Returns false on a bad size, any file error or if the
+     * panel buffers cannot be allocated (out may then be partly written).
+     */
+    static bool fft_file(const char *in_path, const char *out_path, int64_t n, int32_t isInverse,
+                         size_t mem_bytes = (size_t) 256 << 20)
+    {
+        WDLFFT_MappedFile in, out;
+        if (!valid(n)) return false;
+        if (!in.open(in_path, 0) || in.size() < (uint64_t) n * sizeof(cmplxT<T>)) return false;
+        if (!out.open(out_path, (uint64_t) n * sizeof(cmplxT<T>))) return false;
+
+        return four_step((const cmplxT<T> *) in.data(), (cmplxT<T> *) out.data(), n, isInverse, mem_bytes);
+    }
+
+    /*
+     * in_path holds n real T, out_path is created with X[0..n/2], n/2+1
+     * cmplxT<T>. n a power of two in 8..2^31. Fails as fft_file does.
+     */
+    static bool real_fft_file(const char *in_path, const char *out_path, int64_t n,
+                              size_t mem_bytes = (size_t) 256 << 20)
+    {
+        WDLFFT_MappedFile in, out;
+        const int64_t m = n / 2;
+        if (n < 8 || !valid(m)) return false;
+        if (!in.open(in_path, 0) || in.size() < (uint64_t) n * sizeof(T)) return false;
+        if (!out.open(out_path, (uint64_t)(m + 1) * sizeof(cmplxT<T>))) return false;
+
+        cmplxT<T> *z = (cmplxT<T> *) out.data();
+        if (!four_step((const cmplxT<T> *) in.data(), z, m, 0, mem_bytes)) return false;
+        real_split(z, m);
+        return true;
+    }
+
+    /* the same on memory buffers (in and out must not overlap), for data that does fit */
+    static bool fft(const cmplxT<T> *in, cmplxT<T> *out, int64_t n, int32_t isInverse, size_t mem_bytes = (size_t) 256 << 20)
+    {
+        return valid(n) && four_step(in, out, n, isInverse, mem_bytes);
+    }
+
+private:
+
+    static bool valid(int64_t n) { return n >= 4 && n <= ((int64_t) 1 << MAX_LOG2) && !(n & (n - 1)); }
+
+    static int32_t log2i(int64_t n)
+    {
+        int32_t b = 0;
+        while (((int64_t) 1 << b) < n) b ++;
+        return b;
+    }
+
+    /* exp(-2*pi*i*m/n) for 0 <= m < n from two tables of ~sqrt(n) entries */
+    class twiddles {
+    public:
+        twiddles(int64_t n) : m_n(n)
+        {
+            const int32_t bits = log2i(n);
+            int64_t i;
+            m_lobits = (bits + 1) / 2;
+            const int64_t nlo = (int64_t) 1 << m_lobits, nhi = n >> m_lobits;
+            m_lo = new cmplxT<double>[nlo];
+            m_hi = new cmplxT<double>[nhi];
+            for (i = 0; i < nlo; i ++)
+            {
+                m_lo[i].re = cos(2.0 * M_PI * (double) i / (double) n);
+                m_lo[i].im = -sin(2.0 * M_PI * (double) i / (double) n);
+            }
+            for (i = 0; i < nhi; i ++)
+            {
+                m_hi[i].re = cos(2.0 * M_PI * (double) i / (double) nhi);
+                m_hi[i].im = -sin(2.0 * M_PI * (double) i / (double) nhi);
+            }
+        }
+        ~twiddles()
+        {
+            delete [] m_lo;
+            delete [] m_hi;
+        }
+
+        cmplxT<double> operator()(int64_t m) const
+        {
+            m &= m_n - 1;
+            const cmplxT<double> &a = m_lo[m & (((int64_t) 1 << m_lobits) - 1)], &b = m_hi[m >> m_lobits];
+            cmplxT<double> r;
+            r.re = a.re * b.re - a.im * b.im;
+            r.im = a.re * b.im + a.im * b.re;
+            return r;
+        }
+
+    private:
+        twiddles(const twiddles &);
+        twiddles &operator=(const twiddles &);
+
+        int64_t m_n;
+        int32_t m_lobits;
+        cmplxT<double> *m_lo, *m_hi;
+    };
+
+    /* dst[c*rows + r] = src[r*stride + col0 + c], conjugated if conj; c < P. In TILE x TILE tiles */
+    static void gather(cmplxT<T> *dst, const cmplxT<T> *src, int64_t rows, int64_t stride, int64_t col0, int64_t P, bool conj)
+    {
+        int64_t r0, c0, r, c;
+        for (r0 = 0; r0 < rows; r0 += TILE)
+        {
+            const int64_t r1 = r0 + TILE < rows ? r0 + TILE : rows;
+            for (c0 = 0; c0 < P; c0 += TILE)
+            {
+                const int64_t c1 = c0 + TILE < P ? c0 + TILE : P;
+                for (c = c0; c < c1; c ++)
+                    for (r = r0; r < r1; r ++)
+                    {
+                        const cmplxT<T> &v = src[r * stride + col0 + c];
+                        dst[c * rows + r].re = v.re;
+                        dst[c * rows + r].im = conj ? -v.im : v.im;
+                    }
+            }
+        }
+    }
+
+    /* false if a panel or scratch buffer could not be allocated */
+    static bool four_step(const cmplxT<T> *in, cmplxT<T> *out, int64_t n, int32_t isInverse, size_t mem_bytes)
+    {
+        const int32_t bits = log2i(n);
+        const int64_t n1 = (int64_t) 1 << ((bits + 1) / 2), n2 = n / n1;
+        const bool conj = !!isInverse;  // inverse = conj(forward(conj(x)))
+        const twiddles tw(n);
+
+        WDLFFT<T>::WDL_fft_init();
+
+        // pass 1: columns of x (n1 rows of n2) -> out[n2 * n1 + k1], twiddled
+        {
+            const int64_t P = panel(n2, n1, mem_bytes);
+            const int32_t *perm = WDLFFT<T>::WDL_fft_permute_tab((int32_t) n1);
+            const bool ok = run_panels(in, n1, n2, P, conj, [&](cmplxT<T> *buf, int64_t col0)
+            {
+                int64_t c, k;
+                for (c = 0; c < P; c ++)
+                {
+                    cmplxT<T> *col = buf + c * n1, *dst = out + (col0 + c) * n1;
+                    WDLFFT<T>::fft(col, (int32_t) n1, 0);
+                    for (k = 0; k < n1; k ++)
+                    {
+                        const cmplxT<T> v = col[perm[k]];
+                        const cmplxT<double> w = tw((col0 + c) * k);
+                        dst[k].re = (T)(v.re * w.re - v.im * w.im);
+                        dst[k].im = (T)(v.re * w.im + v.im * w.re);
+                    }
+                }
+            });
+            if (!ok) return false;
+        }
+
+        // pass 2: columns of out (n2 rows of n1) -> X[k1 + n1 * k2], in place
+        {
+            const int64_t P = panel(n1, n2, mem_bytes);
+            const int32_t *perm = WDLFFT<T>::WDL_fft_permute_tab((int32_t) n2);
+            WDLFFT_Scratch scratch;
+            cmplxT<T> *tmp = scratch.get< cmplxT<T> >((size_t) n2);
+            if (!tmp) return false;
+            const bool ok = run_panels(out, n2, n1, P, false, [&](cmplxT<T> *buf, int64_t col0)
+            {
+                int64_t c, c0, k, k0;
+
+                // each column to natural order while it is in cache
+                for (c = 0; c < P; c ++)
+                {
+                    cmplxT<T> *col = buf + c * n2;
+                    WDLFFT<T>::fft(col, (int32_t) n2, 0);
+                    for (k = 0; k < n2; k ++) tmp[k] = col[perm[k]];
+                    memcpy(col, tmp, n2 * sizeof(cmplxT<T>));
+                }
+
+                // then a tiled transpose back into the panel's columns of out
+                for (k0 = 0; k0 < n2; k0 += TILE)
+                    for (c0 = 0; c0 < P; c0 += TILE)
+                    {
+                        const int64_t k1 = k0 + TILE < n2 ? k0 + TILE : n2, c1 = c0 + TILE < P ? c0 + TILE : P;
+                        for (k = k0; k < k1; k ++)
+                        {
+                            cmplxT<T> *dst = out + k * n1 + col0;
+                            for (c = c0; c < c1; c ++)
+                            {
+                                dst[c].re = buf[c * n2 + k].re;
+                                dst[c].im = conj ? -buf[c * n2 + k].im : buf[c * n2 + k].im;
+                            }
+                        }
+                    }
+            });
+            if (!ok) return false;
+        }
+        return true;
+    }
+
+    /* columns per panel: a power of two, two panels of rows each within mem_bytes */
+    static int64_t panel(int64_t cols, int64_t rows, size_t mem_bytes)
+    {
+        int64_t P = 1;
+        while (P < cols && (uint64_t)(2 * P) * rows * sizeof(cmplxT<T>) * 2 <= mem_bytes) P *= 2;
+        return P;
+    }
+
+    /*
+     * Gathers panels of P columns of src (rows x cols, row-major) on a
+     * reader thread, one panel ahead of fn(buf, col0) on this thread.
+     * Returns false, without calling fn, if the two panels cannot be
+     * allocated.
+     */
+    template <typename F>
+    static bool run_panels(const cmplxT<T> *src, int64_t rows, int64_t cols, int64_t P, bool conj, const F &fn)
+    {
+        cmplxT<T> *buf[2];
+        int64_t col0;
+        int32_t cur = 0;
+
+        buf[0] = (cmplxT<T> *) WDL_fft_aligned_alloc((size_t)(P * rows) * sizeof(cmplxT<T>));
+        buf[1] = (cmplxT<T> *) WDL_fft_aligned_alloc((size_t)(P * rows) * sizeof(cmplxT<T>));
+        if (!buf[0] || !buf[1])
+        {
+            WDL_fft_aligned_free(buf[0]);
+            WDL_fft_aligned_free(buf[1]);
+            return false;
+        }
+
+        gather(buf[0], src, rows, cols, 0, P, conj);
+        for (col0 = 0; col0 < cols; col0 += P)
+        {
+            std::thread reader;
+            if (col0 + P < cols)
+                reader = std::thread(gather, buf[cur ^ 1], src, rows, cols, col0 + P, P, conj);
+            fn(buf[cur], col0);
+            if (reader.joinable()) reader.join();
+            cur ^= 1;
+        }
+
+        WDL_fft_aligned_free(buf[0]);
+        WDL_fft_aligned_free(buf[1]);
+        return true;
+    }
+
+    /*
+     * z[0..m-1] = DFT of x as m complex pairs -> X[0..m] of the 2m reals,
+     * in place. E = (Z[k] + conj(Z[m-k]))/2, O = (Z[k] - conj(Z[m-k]))/2i,
+     * X[k] = E + w^k O, X[m-k] = conj(E - w^k O), w = exp(-2*pi*i/2m).
+     */
+    static void real_split(cmplxT<T> *z, int64_t m)
+    {
+        const twiddles tw(2 * m);
+        int64_t k;
+
+        const T re = z[0].re, im = z[0].im;
+        z[0].re = re + im;
+        z[0].im = 0;
+        z[m].re = re - im;
+        z[m].im = 0;
+
+        for (k = 1; k <= m / 2; k ++)
+        {
+            const cmplxT<T> a = z[k], b = z[m - k];
+            const double er = 0.5 * ((double) a.re + b.re), ei = 0.5 * ((double) a.im - b.im);
+            const double orr = 0.5 * ((double) a.im + b.im), oi = -0.5 * ((double) a.re - b.re);
+            const cmplxT<double> w = tw(k);
+            const double tr = w.re * orr - w.im * oi, ti = w.re * oi + w.im * orr;
+            z[k].re = (T)(er + tr);
+            z[k].im = (T)(ei + ti);
+            z[m - k].re = (T)(er - tr);
+            z[m - k].im = (T)(ti - ei);
+        }
+    }
+};
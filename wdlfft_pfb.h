@@ -0,0 +1,213 @@
+/*
+ **  Polyphase FFT channelizer (analysis filterbank) on top of WDLFFT
+ **
+ **  C++ wrapper (C)2024 DEMOS
+ **  GITHUB: https://github.com/mewza or Email: subband@protonmail.com
+ **  LICENSE: same as wdlfft.h
+ **
+ **  WDLFFT_PFB<T> splits a complex stream into M equally spaced channels,
+ **  channel k centered at k/M cycles per sample. Every hop D = M (critically
+ **  sampled) or D = M/2 (2x oversampled) input samples it emits one block
+ **  of M channel samples:
+ **
+ **    y_k[t] = sum_{n<P*M} h[n] * x[s+n] * exp(-2*pi*i*k*(s+n)/M),  s = (t+1)*D - P*M
+ **
+ **  with x[<0] = 0 and h the P*M tap prototype lowpass (cutoff 1/(2M), DC
+ **  gain 1, so a tone at a channel center comes out at its own amplitude).
+ **  The P taps of each branch are folded (the polyphase MAC) straight into
+ **  the block's output buffer, rotated by s mod M so the phase is that of
+ **  absolute time, and WDLFFT<T>::fft runs on it in place. The block is
+ **  left in WDL_fft_permute(M) order: channel k is out[channel_index(k)],
+ **  no reorder pass.
+ **
+ **  T may be a vector type: each lane is an independent stream (antenna,
+ **  capture) channelized by the same filterbank.
+ */
+
+#pragma once
+
+#include "wdlfft.h"
+
+template <typename T>
+class WDLFFT_PFB {
+public:
+
+    WDLFFT_PFB() : m_m(0), m_p(0), m_d(0), m_h(0), m_buf(0), m_cap(0), m_fill(0), m_base(0), m_blocks(0) { }
+    ~WDLFFT_PFB() { free_bufs(); }
+
+    /*
+     * channels = M, a power of two in 2..32768; taps = P per branch;
+     * oversample 1 or 2. proto, if given, holds the P*M prototype taps,
+     * otherwise design_prototype() is used. Returns false on bad arguments.
+     */
+    bool init(int32_t channels, int32_t taps = 8, int32_t oversample = 1, const double *proto = 0)
+    {
+        int32_t i;
+        free_bufs();
+        if (channels < 2 || channels > (1 << FFT_MAXBITLEN) || (channels & (channels - 1))) return false;
+        if (taps < 1 || (oversample != 1 && oversample != 2)) return false;
+
+        WDLFFT<T>::WDL_fft_init();
+
+        m_m = channels;
+        m_p = taps;
+        m_d = channels / oversample;
+
+        const int32_t len = m_m * m_p;
+        double *h = new double[len];
+        if (proto) memcpy(h, proto, len * sizeof(double));
+        else design_prototype(h, m_m, m_p);
+
+        m_h = (T *) WDLFFT<T>::alloc_buffer((len + 1) / 2);
+        for (i = 0; i < len; i ++) m_h[i] = (T) h[i];
+        delete [] h;
+
+        // room for P*M of history plus a few hops, so the shift is rare
+        m_cap = len + 4 * m_m;
+        m_buf = WDLFFT<T>::alloc_buffer(m_cap);
+        reset();
+        return true;
+    }
+
+    /* clears the history to zeros and restarts block counting */
+    void reset()
+    {
+        const int32_t hist = m_m * m_p - m_d;
+        if (!m_buf) return;
+        memset(m_buf, 0, hist * sizeof(cmplxT<T>));
+        m_base = 0;
+        m_fill = hist;
+        m_blocks = 0;
+    }
+
+    int32_t channels() const { return m_m; }
+    int32_t hop() const { return m_d; }
+
+    /* position of channel k within an output block */
+    int32_t channel_index(int32_t k) const { return WDLFFT<T>::WDL_fft_permute(m_m, k); }
+
+    /*
+     * Consumes n input samples, writes one block of M channel samples to
+     * out per completed hop and returns the number of blocks. out must
+     * hold (n / hop() + 1) * channels() values.
+     */
+    int32_t process(const cmplxT<T> *in, int32_t n, cmplxT<T> *out)
+    {
+        const int32_t len = m_m * m_p;
+        int32_t nb = 0;
+
+        while (n > 0)
+        {
+            if (m_fill == m_cap)
+            {
+                // keep the P*M - D samples the next block still needs
+                memmove(m_buf, m_buf + m_base, (m_fill - m_base) * sizeof(cmplxT<T>));
+                m_fill -= m_base;
+                m_base = 0;
+            }
+
+            const int32_t need = m_base + len - m_fill; // samples until the next block
+            int32_t c = m_cap - m_fill;
+            if (c > n) c = n;
+            if (c > need) c = need;
+
+            memcpy(m_buf + m_fill, in, c * sizeof(cmplxT<T>));
+            m_fill += c;
+            in += c;
+            n -= c;
+
+            if (c == need)
+            {
+                block(m_buf + m_base, out);
+                WDLFFT<T>::fft(out, m_m, 0);
+                out += m_m;
+                m_base += m_d;
+                nb ++;
+            }
+        }
+        return nb;
+    }
+
+    /*
+     * Blackman-Harris windowed sinc, cutoff 1/(2*channels), len
+     * channels*taps, normalized to a DC gain of 1. With 8 taps per branch
+     * the stopband starts about 1/channels from the channel center and
+     * sits below -90 dB.
+     */
+    static void design_prototype(double *h, int32_t channels, int32_t taps)
+    {
+        const int32_t len = channels * taps;
+        const double c = (len - 1) * 0.5;
+        double sum = 0;
+        int32_t i;
+
+        for (i = 0; i < len; i ++)
+        {
+            const double x = (i - c) / channels, a = 2.0 * M_PI * i / (len - 1);
+            const double s = fabs(x) < 1e-12 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+            const double w = 0.35875 - 0.48829 * cos(a) + 0.14128 * cos(2 * a) - 0.01168 * cos(3 * a);
+            h[i] = s * w;
+            sum += h[i];
+        }
+        for (i = 0; i < len; i ++) h[i] /= sum;
+    }
+
+private:
+
+    // owns the taps and history buffers
+    WDLFFT_PFB(const WDLFFT_PFB &);
+    WDLFFT_PFB &operator=(const WDLFFT_PFB &);
+
+    /* out[(m + s) mod M] = sum_p h[p*M + m] * seg[p*M + m] */
+    void block(const cmplxT<T> *seg, cmplxT<T> *out)
+    {
+        const int32_t rot = (int32_t)(((int64_t)(m_blocks + 1) * m_d) & (m_m - 1));
+        const int32_t n1 = m_m - rot;
+        int32_t p;
+
+        // the rotation splits each branch into two contiguous runs
+        for (p = 0; p < m_p; p ++)
+        {
+            const T *h = m_h + p * m_m;
+            const cmplxT<T> *x = seg + p * m_m;
+            mac(out + rot, h, x, n1, !p);
+            mac(out, h + n1, x + n1, rot, !p);
+        }
+        m_blocks = (m_blocks + 1) & (m_m - 1);
+    }
+
+    static void mac(cmplxT<T> *o, const T *h, const cmplxT<T> *x, int32_t n, bool first)
+    {
+        int32_t m;
+        if (first)
+        {
+            for (m = 0; m < n; m ++)
+            {
+                o[m].re = h[m] * x[m].re;
+                o[m].im = h[m] * x[m].im;
+            }
+        } else
+        {
+            for (m = 0; m < n; m ++)
+            {
+                o[m].re += h[m] * x[m].re;
+                o[m].im += h[m] * x[m].im;
+            }
+        }
+    }
+
+    void free_bufs()
+    {
+        WDLFFT<T>::free_buffer(m_h);
+        WDLFFT<T>::free_buffer(m_buf);
+        m_h = 0;
+        m_buf = 0;
+        m_m = m_p = m_d = 0;
+    }
+
+    int32_t m_m, m_p, m_d;      // channels, taps per branch, hop
+    T *m_h;                     // prototype, P*M taps
+    cmplxT<T> *m_buf;           // input history
+    int32_t m_cap, m_fill, m_base;
+    int32_t m_blocks;           // blocks emitted, mod M
+};
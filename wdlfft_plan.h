@@ -0,0 +1,395 @@
+/*
+ **  Measuring planner for WDLFFT: picks the fastest kernel schedule per
+ **  size, type and direction on the running machine
+ **
+ **  C++ wrapper (C)2024 DEMOS
+ **  GITHUB: https://github.com/mewza or Email: subband@protonmail.com
+ **  LICENSE: same as wdlfft.h
+ **
+ **  Every kernel computes the same transform (same scaling and
+ **  WDL_fft_permute order as WDLFFT<T>::fft / real_fft), they only differ
+ **  in how the work is scheduled:
+ **
+ **    recursive  the runtime size switch, WDLFFT<T>::fft / real_fft
+ **    fixed      the compile-time unrolled fft<N> / real_fft<N> (C++17)
+ **
+ **  plan() times each candidate on a scratch buffer and remembers the
+ **  winner; fft() / real_fft() dispatch to it, or to "recursive" for
+ **  anything not planned. save_wisdom() writes the choices to a text file
+ **  tagged with the host CPU, load_wisdom() reads them back (entries from
+ **  another CPU or for another T are skipped), so later runs need not
+ **  measure again:
+ **
+ **    WDLFFT_Planner<simd_float8> pl;
+ **    if (!pl.load_wisdom("wdlfft.wisdom"))
+ **    {
+ **        pl.plan(4096, 0); pl.plan(4096, 1);
+ **        pl.save_wisdom("wdlfft.wisdom");
+ **    }
+ **    pl.fft(buf, 4096, 0);
+ **
+ **  NOTE: plan() and load_wisdom() are not thread safe, fft() and
+ **        real_fft() are once the plans are in place.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <chrono>
+#include "wdlfft.h"
+
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <cpuid.h>
+#endif
+
+template <typename T>
+class WDLFFT_Planner {
+public:
+
+    enum {
+        KERNEL_RECURSIVE = 0,
+        KERNEL_FIXED,
+        KERNEL_COUNT
+    };
+
+    WDLFFT_Planner()
+    {
+        memset(m_kernel, UNPLANNED, sizeof(m_kernel));
+    }
+
+    static const char *kernel_name(int32_t k)
+    {
+        static const char *names[KERNEL_COUNT] = { "recursive", "fixed" };
+        return k >= 0 && k < KERNEL_COUNT ? names[k] : "?";
+    }
+
+    /* true if kernel k can run a transform of len (isReal: real_fft) */
+    static bool kernel_supported(int32_t k, int32_t len, bool isReal)
+    {
+        (void) isReal;     // every kernel runs both; kept for kernels that might not
+        if (len < 2 || len > (1 << FFT_MAXBITLEN) || (len & (len - 1))) return false;
+        switch (k)
+        {
+            case KERNEL_RECURSIVE: return true;
+#if __cplusplus >= 201703L
+            case KERNEL_FIXED: return true;
+#endif
+        }
+        return false;
+    }
+
+    /*
+     * Times every supported kernel for (len, isInverse, isReal), keeps
+     * the fastest and returns it, or -1 if len is not a supported size.
+     * Each candidate gets roughly budget_ms of wall time.
+     */
+    int32_t plan(int32_t len, int32_t isInverse, bool isReal = false, double budget_ms = 20.0)
+    {
+        if (!kernel_supported(KERNEL_RECURSIVE, len, isReal)) return -1;
+        WDLFFT<T>::WDL_fft_init();
+
+        WDLFFT_Scratch scratch;
+        cmplxT<T> *buf = scratch.get< cmplxT<T> >(len);
+        double best = 0;
+        int32_t k, win = KERNEL_RECURSIVE;
+
+        for (k = 0; k < KERNEL_COUNT; k ++)
+        {
+            if (!kernel_supported(k, len, isReal)) continue;
+
+            refill(buf, len);
+            run(k, buf, len, isInverse, isReal); // warm up caches and tables
+
+            const double t = measure(k, buf, len, isInverse, isReal, budget_ms);
+            if (k == KERNEL_RECURSIVE || t < best)
+            {
+                best = t;
+                win = k;
+            }
+        }
+        set_kernel(len, isInverse, isReal, win);
+        return win;
+    }
+
+    /* the kernel fft()/real_fft() will use, KERNEL_RECURSIVE if unplanned */
+    int32_t kernel(int32_t len, int32_t isInverse, bool isReal = false) const
+    {
+        if (len < 2) return KERNEL_RECURSIVE;     // floorlog2 needs len >= 1
+        const int32_t b = WDLFFT<T>::floorlog2(len);
+        if (b > FFT_MAXBITLEN || m_kernel[slot(b, isInverse, isReal)] == UNPLANNED) return KERNEL_RECURSIVE;
+        return m_kernel[slot(b, isInverse, isReal)];
+    }
+
+    /* forces a kernel, returns false if it cannot run len */
+    bool set_kernel(int32_t len, int32_t isInverse, bool isReal, int32_t k)
+    {
+        if (!kernel_supported(k, len, isReal)) return false;
+        m_kernel[slot(WDLFFT<T>::floorlog2(len), isInverse, isReal)] = (uint8_t) k;
+        return true;
+    }
+
+    /* same contract as WDLFFT<T>::fft: 0 done, -1 len not supported, buf untouched */
+    int32_t fft(cmplxT<T> *buf, int32_t len, int32_t isInverse) const
+    {
+        return run(kernel(len, isInverse, false), buf, len, isInverse, false);
+    }
+
+    /* same contract as WDLFFT<T>::real_fft */
+    int32_t real_fft(T *buf, int32_t len, int32_t isInverse) const
+    {
+        return run(kernel(len, isInverse, true), (cmplxT<T> *)buf, len, isInverse, true);
+    }
+
+    /*
+     * Wisdom file, one line per planned entry:
+     *   cpu <host id>
+     *   <type tag> <c|r> <len> <fwd|inv> <kernel name>
+     * Only planned (or set_kernel) entries are written. save_wisdom() merges
+     * into an existing file: lines for other types or other CPUs are kept,
+     * this type's entries for this CPU are replaced.
+     */
+    bool save_wisdom(const char *path) const
+    {
+        char line[512], host[128], cur[sizeof(line)] = "", last[sizeof(line)] = "";
+        char *keep = 0;
+        size_t keep_len = 0, keep_cap = 0;
+        int32_t b, inv, real;
+
+        host_id(host, sizeof(host));
+
+        FILE *fp = fopen(path, "r");
+        if (fp)
+        {
+            while (fgets(line, sizeof(line), fp))
+            {
+                if (!strncmp(line, "cpu ", 4))
+                {
+                    snprintf(cur, sizeof(cur), "%s", line + 4);
+                    cur[strcspn(cur, "\r\n")] = 0;
+                    continue;
+                }
+                if (line[0] == '#' || (!strcmp(cur, host) && is_own_entry(line))) continue;
+
+                // other CPU or other type: keep, under its cpu line
+                const size_t need = strlen(cur) + strlen(line) + 8;
+                if (keep_len + need > keep_cap)
+                {
+                    keep_cap = (keep_len + need) * 2;
+                    char *k = (char *)realloc(keep, keep_cap);
+                    if (!k) break;
+                    keep = k;
+                }
+                if (strcmp(cur, last))
+                {
+                    keep_len += sprintf(keep + keep_len, "cpu %s\n", cur);
+                    strcpy(last, cur);
+                }
+                keep_len += sprintf(keep + keep_len, "%s", line);
+            }
+            fclose(fp);
+        }
+
+        fp = fopen(path, "w");
+        if (!fp)
+        {
+            free(keep);
+            return false;
+        }
+        fprintf(fp, "# wdlfft wisdom v1\n");
+        if (keep) fwrite(keep, 1, keep_len, fp);
+        free(keep);
+
+        if (strcmp(last, host)) fprintf(fp, "cpu %s\n", host);
+        for (b = 1; b <= FFT_MAXBITLEN; b ++)
+            for (real = 0; real < 2; real ++)
+                for (inv = 0; inv < 2; inv ++)
+                    if (m_kernel[slot(b, inv, real != 0)] != UNPLANNED)
+                        fprintf(fp, "%s %c %d %s %s\n", type_tag(), real ? 'r' : 'c', 1 << b, inv ? "inv" : "fwd",
+                                kernel_name(m_kernel[slot(b, inv, real != 0)]));
+        return !fclose(fp);
+    }
+
+    /*
+     * Applies the entries for this T recorded on this CPU. Returns true if
+     * at least one was found, false if the file is missing or has none
+     * (then call plan() and save_wisdom()).
+     */
+    bool load_wisdom(const char *path)
+    {
+        char line[512], host[128], cur[sizeof(line)] = "";
+        char tag[32], kind, dir[8], name[32];
+        int32_t len, k, found = 0;
+
+        FILE *fp = fopen(path, "r");
+        if (!fp) return false;
+        host_id(host, sizeof(host));
+
+        while (fgets(line, sizeof(line), fp))
+        {
+            if (!strncmp(line, "cpu ", 4))
+            {
+                snprintf(cur, sizeof(cur), "%s", line + 4);
+                cur[strcspn(cur, "\r\n")] = 0;
+                continue;
+            }
+            if (strcmp(cur, host)) continue;
+            if (sscanf(line, "%31s %c %d %7s %31s", tag, &kind, &len, dir, name) != 5) continue;
+            if (strcmp(tag, type_tag())) continue;
+
+            for (k = 0; k < KERNEL_COUNT; k ++)
+                if (!strcmp(name, kernel_name(k)) && set_kernel(len, !strcmp(dir, "inv"), kind == 'r', k))
+                {
+                    found ++;
+                    break;
+                }
+        }
+        fclose(fp);
+        return found > 0;
+    }
+
+    /* "f32x8" style tag for T, used to key wisdom entries */
+    static const char *type_tag()
+    {
+        static char tag[32];
+        typedef typename WDLFFT<T>::scalar_t S;
+        const int32_t lanes = (int32_t)(sizeof(T) / sizeof(S));
+        if (!tag[0])
+        {
+            if (lanes > 1) snprintf(tag, sizeof(tag), "f%dx%d", (int)(8 * sizeof(S)), lanes);
+            else snprintf(tag, sizeof(tag), "f%d", (int)(8 * sizeof(S)));
+        }
+        return tag;
+    }
+
+    /* CPU brand string, spaces replaced so it fits on one line */
+    static void host_id(char *out, size_t sz)
+    {
+        char s[64] = "unknown";
+#if defined(__APPLE__)
+        size_t l = sizeof(s) - 1;
+        if (sysctlbyname("machdep.cpu.brand_string", s, &l, 0, 0)) strcpy(s, "unknown");
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+        unsigned int r[12], i;
+        if (__get_cpuid_max(0x80000000, 0) >= 0x80000004)
+        {
+            for (i = 0; i < 3; i ++) __get_cpuid(0x80000002 + i, &r[i * 4], &r[i * 4 + 1], &r[i * 4 + 2], &r[i * 4 + 3]);
+            memcpy(s, r, 48);
+            s[48] = 0;
+        }
+#endif
+        size_t i2, o = 0;
+        for (i2 = 0; s[i2] && o + 1 < sz; i2 ++)
+        {
+            if (s[i2] == ' ' && (!o || out[o - 1] == '_')) continue;
+            out[o ++] = s[i2] == ' ' ? '_' : s[i2];
+        }
+        while (o && out[o - 1] == '_') o --;
+        out[o] = 0;
+    }
+
+private:
+
+    enum { UNPLANNED = 0xff };
+    uint8_t m_kernel[(FFT_MAXBITLEN + 1) * 4];
+
+    static int32_t slot(int32_t bits, int32_t isInverse, bool isReal)
+    {
+        return bits * 4 + (isInverse ? 1 : 0) + (isReal ? 2 : 0);
+    }
+
+    static bool is_own_entry(const char *line)
+    {
+        const size_t l = strlen(type_tag());
+        return !strncmp(line, type_tag(), l) && line[l] == ' ';
+    }
+
+    /* seconds per transform */
+    static double measure(int32_t k, cmplxT<T> *buf, int32_t len, int32_t isInverse, bool isReal, double budget_ms)
+    {
+        typedef std::chrono::steady_clock clk;
+        double best = 1e30;
+        int32_t reps = 1, i, trial;
+
+        // grow the batch until it takes a tenth of the budget, then keep the best of 10 batches
+        for (;;)
+        {
+            const clk::time_point t0 = clk::now();
+            for (i = 0; i < reps; i ++) run(k, buf, len, isInverse, isReal);
+            const double t = std::chrono::duration<double>(clk::now() - t0).count();
+            if (t * 1e4 >= budget_ms || reps >= (1 << 20)) break;
+            reps *= 2;
+        }
+        for (trial = 0; trial < 10; trial ++)
+        {
+            const clk::time_point t0 = clk::now();
+            for (i = 0; i < reps; i ++) run(k, buf, len, isInverse, isReal);
+            const double t = std::chrono::duration<double>(clk::now() - t0).count() / reps;
+            if (t < best) best = t;
+            refill(buf, len);
+        }
+        return best;
+    }
+
+    /*
+     * Small finite test data; refilled between batches so repeated
+     * unnormalized transforms neither overflow nor decay into denormals.
+     */
+    static void refill(cmplxT<T> *buf, int32_t len)
+    {
+        int32_t x;
+        for (x = 0; x < len; x ++)
+        {
+            buf[x].re = (T) (float) ((x * 7 % 13) * (1.0 / 13.0));
+            buf[x].im = (T) (float) ((x * 5 % 11) * (1.0 / 11.0));
+        }
+    }
+
+    static int32_t run(int32_t k, cmplxT<T> *buf, int32_t len, int32_t isInverse, bool isReal)
+    {
+        if (isReal)
+        {
+#if __cplusplus >= 201703L
+            if (k == KERNEL_FIXED) return real_fixed(buf, len, isInverse);
+#endif
+            return WDLFFT<T>::real_fft((T *)buf, len, isInverse);
+        }
+        switch (k)
+        {
+#if __cplusplus >= 201703L
+            case KERNEL_FIXED: return fixed(buf, len, isInverse);
+#endif
+        }
+        return WDLFFT<T>::fft(buf, len, isInverse);
+    }
+
+#if __cplusplus >= 201703L
+
+    /* fft<N> / real_fft<N> have no status; a length outside the table is -1 like the runtime call */
+    static int32_t fixed(cmplxT<T> *buf, int32_t len, int32_t isInverse)
+    {
+        switch (len)
+        {
+#define TMP(x) case x: WDLFFT<T>::template fft<x>(buf, isInverse); return 0;
+            TMP(2) TMP(4) TMP(8) TMP(16) TMP(32) TMP(64) TMP(128) TMP(256)
+            TMP(512) TMP(1024) TMP(2048) TMP(4096) TMP(8192) TMP(16384) TMP(32768)
+#undef TMP
+        }
+        return -1;
+    }
+
+    static int32_t real_fixed(cmplxT<T> *buf, int32_t len, int32_t isInverse)
+    {
+        switch (len)
+        {
+#define TMP(x) case x: WDLFFT<T>::template real_fft<x>((T *)buf, isInverse); return 0;
+            TMP(2) TMP(4) TMP(8) TMP(16) TMP(32) TMP(64) TMP(128) TMP(256)
+            TMP(512) TMP(1024) TMP(2048) TMP(4096) TMP(8192) TMP(16384) TMP(32768)
+#undef TMP
+        }
+        return -1;
+    }
+
+#endif
+};
@@ -0,0 +1,320 @@
+/*
+ **  Phase vocoder time-stretch / pitch-shift on top of WDLFFT::real_fft
+ **
+ **  C++ wrapper (C)2024 DEMOS
+ **  GITHUB: https://github.com/mewza or Email: subband@protonmail.com
+ **  LICENSE: same as wdlfft.h
+ **
+ **  WDLFFT_PVoc<T> is a streaming phase vocoder with identity phase
+ **  locking (Laroche/Dolson): each frame the magnitude peaks get their
+ **  phase from the measured instantaneous frequency, and every bin in a
+ **  peak's region keeps its analysis phase offset to that peak, which
+ **  avoids most of the "phasiness" of a per-bin vocoder.
+ **
+ **    stretch  output duration / input duration, 0.25..8: the synthesis
+ **             hop is fixed at N/4, the analysis hop is N/4 / stretch
+ **    pitch    frequency factor, 0.25..4: each peak region is moved to
+ **             round(peak * pitch) and its phase advanced at the new
+ **             frequency, no resampling
+ **
+ **  Hann analysis and synthesis windows at 4x overlap. real_fft output
+ **  is read and written in place through WDL_fft_permute_tab, so no
+ **  reorder passes; magnitude/phase and resynthesis use branch-free
+ **  polynomial atan2 (~2e-6 rad) and sincos (~1e-6) over scalar_t
+ **  arrays that the compiler vectorizes. T may be a vector type, each
+ **  lane an independent channel; lanes are never mixed.
+ **
+ **  Output comes in blocks of N/4; with stretch = pitch = 1 it is the
+ **  input delayed by 3N/4 samples.
+ */
+
+#pragma once
+
+#include "wdlfft.h"
+
+/* atan2(y, x), max error about 2e-6 rad */
+template <typename S>
+static inline S wdl_fft_fast_atan2(S y, S x)
+{
+    const S ax = x < 0 ? -x : x, ay = y < 0 ? -y : y;
+    const S mx = ax > ay ? ax : ay, mn = ax > ay ? ay : ax;
+    const S a = mx > 0 ? mn / mx : (S) 0, s = a * a;
+    S r = a * ((S) 0.99997726 + s * ((S) -0.33262347 + s * ((S) 0.19354346 +
+               s * ((S) -0.11643287 + s * ((S) 0.05265332 - s * (S) 0.01172120)))));
+    r = ay > ax ? (S) M_PI_2 - r : r;
+    r = x < 0 ? (S) M_PI - r : r;
+    return y < 0 ? -r : r;
+}
+
+/* sin and cos, max error about 1e-6 for float |x| < 10, 3e-7 in double */
+template <typename S>
+static inline void wdl_fft_fast_sincos(S x, S *s, S *c)
+{
+    S y = x * (S)(0.5 / M_PI);
+    y -= floor(y + (S) 0.5);                            // [-0.5, 0.5] turns
+    const S qf = floor(y * 4 + (S) 0.5);                // nearest quarter turn, -2..2
+    const S t = (y - qf * (S) 0.25) * (S)(2.0 * M_PI);  // [-pi/4, pi/4]
+    const S t2 = t * t;
+    const S ps = t * ((S) 1 - t2 * ((S)(1.0 / 6) - t2 * ((S)(1.0 / 120) - t2 * (S)(1.0 / 5040))));
+    const S pc = (S) 1 - t2 * ((S) 0.5 - t2 * ((S)(1.0 / 24) - t2 * ((S)(1.0 / 720) - t2 * (S)(1.0 / 40320))));
+    const int32_t q = (int32_t) qf & 3;
+    *s = q == 0 ? ps : q == 1 ? pc : q == 2 ? -ps : -pc;
+    *c = q == 0 ? pc : q == 1 ? -ps : q == 2 ? -pc : ps;
+}
+
+template <typename T>
+class WDLFFT_PVoc {
+public:
+
+    typedef typename WDLFFT<T>::scalar_t scalar_t;
+
+    static const int32_t L = (int32_t)(sizeof(T) / sizeof(scalar_t));
+
+    WDLFFT_PVoc() : m_n(0), m_hs(0), m_stretch(1), m_pitch(1), m_apos(0), m_fill(0), m_first(true),
+                    m_win(0), m_in(0), m_work(0), m_ola(0), m_state(0), m_peaks(0) { }
+    ~WDLFFT_PVoc() { free_bufs(); }
+
+    /* n = frame size, a power of two in 64..32768. Returns false otherwise. */
+    bool init(int32_t n)
+    {
+        int32_t i;
+        free_bufs();
+        if (n < 64 || n > (1 << FFT_MAXBITLEN) || (n & (n - 1))) return false;
+
+        WDLFFT<T>::WDL_fft_init();
+
+        const int32_t nb = n / 2 + 1;
+        m_n = n;
+        m_hs = n / 4;
+        m_win = (T *) WDLFFT<T>::alloc_buffer(n / 2);
+        m_in = (T *) WDLFFT<T>::alloc_buffer(n * 3 / 2);
+        m_work = (T *) WDLFFT<T>::alloc_buffer(n / 2);
+        m_ola = (T *) WDLFFT<T>::alloc_buffer(n / 2);
+        m_state = (scalar_t *) WDLFFT<T>::alloc_buffer((6 * nb * L * sizeof(scalar_t) + sizeof(cmplxT<T>) - 1) / sizeof(cmplxT<T>));
+        m_peaks = new int32_t[nb];
+
+        // Hann^2 at hop n/4 sums to 1.5; real_fft roundtrip gain is 2n
+        const double g = 1.0 / sqrt(1.5 * 2.0 * n);
+        for (i = 0; i < n; i ++) m_win[i] = (T)(g * (0.5 - 0.5 * cos(2.0 * M_PI * i / n)));
+
+        reset();
+        return true;
+    }
+
+    /* clears input history, overlap-add and phase state: output is as after a fresh init() */
+    void reset()
+    {
+        if (!m_n) return;
+        memset(m_in, 0, 3 * m_n * sizeof(T));
+        memset(m_ola, 0, m_n * sizeof(T));
+        memset(m_state, 0, 6 * (m_n / 2 + 1) * L * sizeof(scalar_t));  // prev/synth phases are read before written
+        m_fill = m_n - m_hs;    // zero history, so the first frame comes after n/4 samples
+        m_apos = 0;
+        m_first = true;
+    }
+
+    void set_stretch(double s) { m_stretch = s < 0.25 ? 0.25 : s > 8 ? 8 : s; }
+    void set_pitch(double p) { m_pitch = p < 0.25 ? 0.25 : p > 4 ? 4 : p; }
+
+    int32_t frame_size() const { return m_n; }
+
+    /* upper bound on what process() writes for n input samples */
+    int32_t max_output(int32_t n) const
+    {
+        const int32_t ha = (int32_t)(m_hs / m_stretch);
+        return ((n + m_n) / (ha > 0 ? ha : 1) + 1) * m_hs;
+    }
+
+    /*
+     * Consumes n samples of in, writes the output that became available
+     * (a multiple of n/4 samples, at most max_output(n)) to out and
+     * returns its length.
+     */
+    int32_t process(const T *in, int32_t n, T *out)
+    {
+        int32_t produced = 0;
+        while (n > 0)
+        {
+            int32_t c = 3 * m_n - m_fill;
+            if (c > n) c = n;
+            memcpy(m_in + m_fill, in, c * sizeof(T));
+            m_fill += c;
+            in += c;
+            n -= c;
+
+            for (;;)
+            {
+                const int32_t start = (int32_t) m_apos;
+                if (start + m_n > m_fill) break;
+
+                const double next = m_apos + m_hs / m_stretch;
+                frame(m_in + start, (int32_t) next - start, out + produced);
+                produced += m_hs;
+                m_apos = next;
+            }
+
+            // drop input no future frame will read
+            const int32_t drop = (int32_t) m_apos;
+            if (drop > 0)
+            {
+                memmove(m_in, m_in + drop, (m_fill - drop) * sizeof(T));
+                m_fill -= drop;
+                m_apos -= drop;
+            }
+        }
+        return produced;
+    }
+
+private:
+
+    // owns the frame, history and state buffers
+    WDLFFT_PVoc(const WDLFFT_PVoc &);
+    WDLFFT_PVoc &operator=(const WDLFFT_PVoc &);
+
+    /* one analysis frame at src, ha samples after the previous one; writes n/4 samples */
+    void frame(const T *src, int32_t ha, T *out)
+    {
+        const int32_t n = m_n, half = n / 2, nb = half + 1;
+        const int32_t *perm = WDLFFT<T>::WDL_fft_permute_tab(half);
+        cmplxT<T> *spec = (cmplxT<T> *) m_work;
+        scalar_t *mag = m_state, *ph = mag + nb * L, *prev = ph + nb * L;
+        scalar_t *syn = prev + nb * L, *omag = syn + nb * L, *oph = omag + nb * L;
+        int32_t i, k, l;
+
+        for (i = 0; i < n; i ++) m_work[i] = src[i] * m_win[i];
+        WDLFFT<T>::real_fft(m_work, n, 0);
+
+        // polar, into [lane][bin] natural order; DC and Nyquist share spec[0]
+        for (k = 0; k < nb; k ++)
+        {
+            const scalar_t *re, *im;
+            if (k == 0 || k == half)
+            {
+                re = (const scalar_t *)(k ? &spec[0].im : &spec[0].re);
+                for (l = 0; l < L; l ++)
+                {
+                    mag[l * nb + k] = re[l] < 0 ? -re[l] : re[l];
+                    ph[l * nb + k] = re[l] < 0 ? (scalar_t) M_PI : 0;
+                }
+                continue;
+            }
+            re = (const scalar_t *) &spec[perm[k]].re;
+            im = (const scalar_t *) &spec[perm[k]].im;
+            for (l = 0; l < L; l ++)
+            {
+                mag[l * nb + k] = sqrt(re[l] * re[l] + im[l] * im[l]);
+                ph[l * nb + k] = wdl_fft_fast_atan2(im[l], re[l]);
+            }
+        }
+
+        for (l = 0; l < L; l ++) lane(mag + l * nb, ph + l * nb, prev + l * nb, syn + l * nb, omag + l * nb, oph + l * nb, ha);
+        m_first = false;
+
+        // back to rectangular, through the same permutation
+        for (k = 0; k < nb; k ++)
+        {
+            scalar_t *re, *im;
+            if (k == 0 || k == half)
+            {
+                re = (scalar_t *)(k ? &spec[0].im : &spec[0].re);
+                for (l = 0; l < L; l ++)
+                {
+                    scalar_t s, c;
+                    wdl_fft_fast_sincos(oph[l * nb + k], &s, &c);
+                    re[l] = omag[l * nb + k] * c;
+                }
+                continue;
+            }
+            re = (scalar_t *) &spec[perm[k]].re;
+            im = (scalar_t *) &spec[perm[k]].im;
+            for (l = 0; l < L; l ++)
+            {
+                scalar_t s, c;
+                wdl_fft_fast_sincos(oph[l * nb + k], &s, &c);
+                re[l] = omag[l * nb + k] * c;
+                im[l] = omag[l * nb + k] * s;
+            }
+        }
+
+        WDLFFT<T>::real_fft(m_work, n, 1);
+        for (i = 0; i < n; i ++) m_ola[i] += m_work[i] * m_win[i];
+
+        memcpy(out, m_ola, m_hs * sizeof(T));
+        memmove(m_ola, m_ola + m_hs, (n - m_hs) * sizeof(T));
+        memset(m_ola + n - m_hs, 0, m_hs * sizeof(T));
+    }
+
+    /* peak picking, phase propagation and pitch move for one lane */
+    void lane(const scalar_t *mag, const scalar_t *ph, scalar_t *prev, scalar_t *syn,
+              scalar_t *omag, scalar_t *oph, int32_t ha)
+    {
+        const int32_t n = m_n, nb = n / 2 + 1;
+        const double bin = 2.0 * M_PI / n;
+        int32_t k, np = 0, j;
+
+        for (k = 0; k < nb; k ++)
+            if (mag[k] > 0 && (k < 1 || mag[k] > mag[k - 1]) && (k < 2 || mag[k] > mag[k - 2]) &&
+                (k + 1 >= nb || mag[k] >= mag[k + 1]) && (k + 2 >= nb || mag[k] >= mag[k + 2]))
+                m_peaks[np ++] = k;
+
+        memset(omag, 0, nb * sizeof(scalar_t));
+        for (k = 0; k < nb; k ++) oph[k] = syn[k];
+
+        for (j = 0; j < np; j ++)
+        {
+            const int32_t p = m_peaks[j];
+            const int32_t lo = j ? (m_peaks[j - 1] + p + 1) / 2 : 0;
+            const int32_t hi = j < np - 1 ? (p + m_peaks[j + 1] + 1) / 2 : nb;
+            const int32_t p2 = (int32_t) floor(p * m_pitch + 0.5), shift = p2 - p;
+            double w, sp;
+
+            if (p2 >= nb) break;
+
+            // instantaneous frequency of the peak in rad/sample
+            w = ph[p] - prev[p] - bin * p * ha;
+            w -= 2.0 * M_PI * floor(w / (2.0 * M_PI) + 0.5);
+            w = bin * p + w / ha;
+
+            sp = m_first ? ph[p] : syn[p2] + w * m_pitch * m_hs;
+            sp -= 2.0 * M_PI * floor(sp / (2.0 * M_PI) + 0.5);
+
+            for (k = lo; k < hi; k ++)
+            {
+                const int32_t k2 = k + shift;
+                if (k2 < 0 || k2 >= nb) continue;
+                omag[k2] += mag[k];
+                oph[k2] = (scalar_t)(sp + ph[k] - ph[p]);
+            }
+        }
+
+        for (k = 0; k < nb; k ++)
+        {
+            prev[k] = ph[k];
+            syn[k] = oph[k];
+        }
+    }
+
+    void free_bufs()
+    {
+        WDLFFT<T>::free_buffer(m_win);
+        WDLFFT<T>::free_buffer(m_in);
+        WDLFFT<T>::free_buffer(m_work);
+        WDLFFT<T>::free_buffer(m_ola);
+        WDLFFT<T>::free_buffer(m_state);
+        delete [] m_peaks;
+        m_win = m_in = m_work = m_ola = 0;
+        m_state = 0;
+        m_peaks = 0;
+        m_n = 0;
+    }
+
+    int32_t m_n, m_hs;          // frame size, synthesis hop
+    double m_stretch, m_pitch;
+    double m_apos;              // next analysis frame start in m_in
+    int32_t m_fill;             // samples in m_in
+    bool m_first;
+
+    T *m_win, *m_in, *m_work, *m_ola;
+    scalar_t *m_state;          // mag, phase, prev phase, synth phase, out mag, out phase; [lane][bin]
+    int32_t *m_peaks;
+};
@@ -0,0 +1,383 @@
+/*
+ **  Accuracy and regression checks for WDLFFT<T> against a reference DFT
+ **
+ **  C++ wrapper (C)2024 DEMOS
+ **  GITHUB: https://github.com/mewza or Email: subband@protonmail.com
+ **  LICENSE: same as wdlfft.h
+ **
+ **  WDLFFT_Reference<T> runs the transforms of WDLFFT<T> (float, double
+ **  or a vector type, every lane checked with its own data) on seeded
+ **  random input and compares them with an O(N^2) long double DFT:
+ **
+ **    check_fft        fft, forward and inverse, output un-permuted
+ **    check_real_fft   real_fft packing, 2x gain, Nyquist in [0].im
+ **    check_roundtrip  forward + inverse == len*x (2*len*x for real_fft)
+ **    check_permute    WDL_fft_permute_tab(len) is a permutation that
+ **                     matches where fft actually puts each bin
+ **    check_reorder    reorder_buffer un-permutes and re-permutes
+ **
+ **  Errors are relative to the RMS of the reference output. run_all()
+ **  does every size 2..32768 and direction, prints a table and returns
+ **  the number of failures, so a test driver is just
+ **
+ **    WDLFFT<float>::WDL_fft_init();
+ **    return WDLFFT_Reference<float>::run_all(stdout) != 0;
+ **
+ **  The DFT is quadratic: a full run_all is ~40 s per lane on a current
+ **  x86 core, most of it at 32768, so it takes a max_len for quick runs. Needs DECL_WDLFFT(T) and
+ **  WDL_fft_init (or WDL_FFT_CONSTEXPR_TABLES) like any other caller.
+ */
+
+#pragma once
+
+#include "wdlfft.h"
+
+template <typename T>
+class WDLFFT_Reference {
+public:
+
+    typedef typename WDLFFT<T>::scalar_t scalar_t;
+    typedef cmplxT<long double> ref_t;
+
+    static const int32_t LANES = (int32_t)(sizeof(T) / sizeof(scalar_t));
+
+    struct result {
+        double max_err;     // max |error| / rms(reference)
+        double rms_err;     // rms(error) / rms(reference)
+        bool ok;
+    };
+
+    /* out[k] = sum in[j] * exp(-+2*pi*i*j*k/n), natural order, n a power of two */
+    static void dft(ref_t *out, const ref_t *in, int32_t n, int32_t isInverse)
+    {
+        ref_t *w = new ref_t[n];
+        int32_t j, k;
+        for (k = 0; k < n; k ++)
+        {
+            const long double a = 2.0L * (long double) M_PI * k / n;
+            w[k].re = cosl(a);
+            w[k].im = isInverse ? sinl(a) : -sinl(a);
+        }
+        for (k = 0; k < n; k ++)
+        {
+            long double re = 0, im = 0;
+            int32_t idx = 0;
+            for (j = 0; j < n; j ++)
+            {
+                re += in[j].re * w[idx].re - in[j].im * w[idx].im;
+                im += in[j].re * w[idx].im + in[j].im * w[idx].re;
+                idx = (idx + k) & (n - 1);
+            }
+            out[k].re = re;
+            out[k].im = im;
+        }
+        delete [] w;
+    }
+
+    /*
+     * Error budget for a transform of len points, relative to the RMS of
+     * the output: a couple of ulps per pass. A check passes if
+     * rms_err <= tol(len) and max_err <= 8 * tol(len).
+     */
+    static double tol(int32_t len)
+    {
+        return 2.0 * (double) std::numeric_limits<scalar_t>::epsilon() * (WDLFFT<T>::floorlog2(len) + 1);
+    }
+
+    /* fft of len points against dft(); the forward output is read through WDL_fft_permute */
+    static result check_fft(int32_t len, int32_t isInverse, uint32_t seed = 1)
+    {
+        const size_t ns = 2 * (size_t) len * LANES;
+        cmplxT<T> *buf = WDLFFT<T>::alloc_buffer(len);
+        scalar_t *src = new scalar_t[ns];
+        ref_t *x = new ref_t[len], *y = new ref_t[len];
+        const scalar_t *out = (const scalar_t *) buf;
+        acc a;
+        int32_t l, i;
+
+        fill(src, ns, seed);
+        memcpy(buf, src, ns * sizeof(scalar_t));
+        WDLFFT<T>::fft(buf, len, isInverse);
+
+        for (l = 0; l < LANES; l ++)
+        {
+            // inverse input is in permuted order, so un-permute it for the dft
+            for (i = 0; i < len; i ++)
+            {
+                const int32_t sp = isInverse ? permute(len, i) : i;
+                x[i].re = src[(2 * sp) * LANES + l];
+                x[i].im = src[(2 * sp + 1) * LANES + l];
+            }
+            dft(y, x, len, isInverse);
+            for (i = 0; i < len; i ++)
+            {
+                const int32_t dp = isInverse ? i : permute(len, i);
+                a.add(out[(2 * dp) * LANES + l], out[(2 * dp + 1) * LANES + l], y[i]);
+            }
+        }
+
+        delete [] src;
+        delete [] x;
+        delete [] y;
+        WDLFFT<T>::free_buffer(buf);
+        return a.get(tol(len));
+    }
+
+    /*
+     * real_fft of len points. Forward: real x in, 2*X[k] out for
+     * k = 0..len/2-1 at WDL_fft_permute(len/2, k), 2*X[len/2] in [0].im.
+     * Inverse: that packing of a Hermitian X in, len*x out.
+     */
+    static result check_real_fft(int32_t len, int32_t isInverse, uint32_t seed = 1)
+    {
+        const int32_t half = len / 2;
+        const size_t ns = (size_t) len * LANES;
+        T *buf = (T *) WDLFFT<T>::alloc_buffer(half);
+        scalar_t *src = new scalar_t[ns];
+        ref_t *x = new ref_t[len], *y = new ref_t[len];
+        const scalar_t *out = (const scalar_t *) buf;
+        acc a;
+        int32_t l, i;
+
+        fill(src, ns, seed);
+        memcpy(buf, src, ns * sizeof(scalar_t));
+        WDLFFT<T>::real_fft(buf, len, isInverse);
+
+        for (l = 0; l < LANES; l ++)
+        {
+            if (!isInverse)
+            {
+                for (i = 0; i < len; i ++)
+                {
+                    x[i].re = src[i * LANES + l];
+                    x[i].im = 0;
+                }
+                dft(y, x, len, 0);
+                for (i = 0; i < half; i ++)
+                {
+                    const int32_t dp = permute(half, i);
+                    ref_t r = { 2 * y[i].re, 2 * y[i].im };
+                    if (!i) r.im = 2 * y[half].re;
+                    a.add(out[(2 * dp) * LANES + l], out[(2 * dp + 1) * LANES + l], r);
+                }
+            } else
+            {
+                // src holds the packed half spectrum; expand it to a Hermitian one
+                for (i = 0; i < half; i ++)
+                {
+                    const int32_t sp = permute(half, i);
+                    x[i].re = src[(2 * sp) * LANES + l];
+                    x[i].im = src[(2 * sp + 1) * LANES + l];
+                }
+                x[half].re = x[0].im;
+                x[half].im = x[0].im = 0;
+                for (i = 1; i < half; i ++)
+                {
+                    x[len - i].re = x[i].re;
+                    x[len - i].im = -x[i].im;
+                }
+                dft(y, x, len, 1);
+                for (i = 0; i < len; i ++)
+                {
+                    const ref_t r = { y[i].re, 0 };
+                    a.add(out[i * LANES + l], 0, r);
+                }
+            }
+        }
+
+        delete [] src;
+        delete [] x;
+        delete [] y;
+        WDLFFT<T>::free_buffer(buf);
+        return a.get(tol(len));
+    }
+
+    /* forward + inverse against len*x (complex) or 2*len*x (real) */
+    static result check_roundtrip(int32_t len, bool real, uint32_t seed = 1)
+    {
+        const size_t ns = (real ? 1 : 2) * (size_t) len * LANES;
+        cmplxT<T> *buf = WDLFFT<T>::alloc_buffer(len);
+        scalar_t *src = new scalar_t[ns];
+        const scalar_t *out = (const scalar_t *) buf;
+        const long double g = real ? 2.0L * len : (long double) len;
+        acc a;
+        size_t i;
+
+        fill(src, ns, seed);
+        memcpy(buf, src, ns * sizeof(scalar_t));
+        if (real)
+        {
+            WDLFFT<T>::real_fft((T *) buf, len, 0);
+            WDLFFT<T>::real_fft((T *) buf, len, 1);
+        } else
+        {
+            WDLFFT<T>::fft(buf, len, 0);
+            WDLFFT<T>::fft(buf, len, 1);
+        }
+
+        for (i = 0; i < ns; i ++)
+        {
+            const ref_t r = { g * src[i], 0 };
+            a.add(out[i], 0, r);
+        }
+
+        delete [] src;
+        WDLFFT<T>::free_buffer(buf);
+        return a.get(2 * tol(len));
+    }
+
+    /*
+     * WDL_fft_permute_tab(len) is a permutation of 0..len-1, and fft of
+     * a unit impulse at 1 puts exp(-2*pi*i*k/len) where it says bin k is.
+     */
+    static bool check_permute(int32_t len)
+    {
+        cmplxT<T> *buf = WDLFFT<T>::alloc_buffer(len);
+        const scalar_t *out = (const scalar_t *) buf;
+        char *seen = new char[len];
+        bool ok = true;
+        int32_t k, l;
+
+        memset(seen, 0, len);
+        for (k = 0; k < len; k ++)
+        {
+            const int32_t p = permute(len, k);
+            if (p < 0 || p >= len || seen[p]) ok = false;
+            else seen[p] = 1;
+        }
+
+        if (ok)
+        {
+            memset(buf, 0, len * sizeof(cmplxT<T>));
+            buf[len > 1 ? 1 : 0].re = (scalar_t) 1;
+            WDLFFT<T>::fft(buf, len, 0);
+            for (k = 0; k < len && ok; k ++)
+            {
+                const int32_t p = permute(len, k);
+                const double a = 2.0 * M_PI * k / len;
+                for (l = 0; l < LANES; l ++)
+                {
+                    const double dr = out[(2 * p) * LANES + l] - cos(a), di = out[(2 * p + 1) * LANES + l] + sin(a);
+                    if (dr * dr + di * di > 1e-6) ok = false;
+                }
+            }
+        }
+
+        delete [] seen;
+        WDLFFT<T>::free_buffer(buf);
+        return ok;
+    }
+
+    /*
+     * reorder_buffer(len, buf, 0) moves bin k from WDL_fft_permute(len, k)
+     * to k, reorder_buffer(len, buf, 1) moves it back. Builds the table
+     * with InitFFTData(len) first.
+     */
+    static bool check_reorder(int32_t len)
+    {
+        cmplxT<T> *buf = WDLFFT<T>::alloc_buffer(len);
+        const scalar_t *out = (const scalar_t *) buf;
+        WDLFFT<T> wdl;
+        bool ok = true;
+        int32_t k;
+
+        WDLFFT<T>::InitFFTData(len);
+        for (k = 0; k < len; k ++)
+        {
+            buf[k].re = (scalar_t) k;
+            buf[k].im = (scalar_t) -k;
+        }
+
+        wdl.reorder_buffer(len, (T *) buf, 0);
+        for (k = 0; k < len; k ++)
+            if (out[(2 * k) * LANES] != (scalar_t) permute(len, k)) ok = false;
+
+        wdl.reorder_buffer(len, (T *) buf, 1);
+        for (k = 0; k < len; k ++)
+            if (out[(2 * k) * LANES] != (scalar_t) k || out[(2 * k + 1) * LANES] != (scalar_t) -k) ok = false;
+
+        WDLFFT<T>::free_buffer(buf);
+        return ok;
+    }
+
+    /*
+     * Every check for every size 2..max_len, one line per size on fp
+     * (may be null). Returns the number of failed checks.
+     */
+    static int32_t run_all(FILE *fp, int32_t max_len = 1 << FFT_MAXBITLEN)
+    {
+        int32_t len, fails = 0;
+
+        if (fp) fprintf(fp, "%6s %19s %19s %19s %19s %9s %9s %4s %4s\n", "len",
+                        "fft fwd rms/max", "fft inv rms/max", "real fwd rms/max", "real inv rms/max",
+                        "rt cplx", "rt real", "perm", "reo");
+
+        for (len = 2; len <= max_len && len <= (1 << FFT_MAXBITLEN); len *= 2)
+        {
+            const result r[6] = {
+                check_fft(len, 0), check_fft(len, 1),
+                check_real_fft(len, 0), check_real_fft(len, 1),
+                check_roundtrip(len, false), check_roundtrip(len, true)
+            };
+            const bool p = check_permute(len), o = check_reorder(len);
+            int32_t i;
+
+            for (i = 0; i < 6; i ++) fails += !r[i].ok;
+            fails += !p + !o;
+
+            if (fp)
+            {
+                fprintf(fp, "%6d", len);
+                for (i = 0; i < 4; i ++) fprintf(fp, " %8.2e/%8.2e%c", r[i].rms_err, r[i].max_err, r[i].ok ? ' ' : '!');
+                for (i = 4; i < 6; i ++) fprintf(fp, " %8.2e%c", r[i].rms_err, r[i].ok ? ' ' : '!');
+                fprintf(fp, " %4s %4s\n", p ? "ok" : "FAIL", o ? "ok" : "FAIL");
+            }
+        }
+        if (fp) fprintf(fp, "%d failure%s\n", fails, fails == 1 ? "" : "s");
+        return fails;
+    }
+
+private:
+
+    static int32_t permute(int32_t len, int32_t k)
+    {
+        return len > 1 ? WDLFFT<T>::WDL_fft_permute(len, k) : 0;
+    }
+
+    /* uniform in [-1, 1), LCG so every platform sees the same data */
+    static void fill(scalar_t *p, size_t n, uint32_t seed)
+    {
+        size_t i;
+        for (i = 0; i < n; i ++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            p[i] = (scalar_t)((int32_t)(seed >> 8) - (1 << 23)) / (scalar_t)(1 << 23);
+        }
+    }
+
+    struct acc {
+        long double err2, ref2, emax;
+        size_t cnt;
+
+        acc() : err2(0), ref2(0), emax(0), cnt(0) { }
+
+        void add(long double re, long double im, const ref_t &r)
+        {
+            const long double dr = re - r.re, di = im - r.im, e = dr * dr + di * di;
+            err2 += e;
+            ref2 += r.re * r.re + r.im * r.im;
+            if (e > emax) emax = e;
+            cnt ++;
+        }
+
+        result get(double t) const
+        {
+            result res;
+            const long double rr = ref2 > 0 ? ref2 : 1;
+            res.rms_err = (double) sqrtl(err2 / rr);
+            res.max_err = (double) sqrtl(emax * cnt / rr);
+            res.ok = res.rms_err <= t && res.max_err <= 8 * t;
+            return res;
+        }
+    };
+};
@@ -0,0 +1,286 @@
+/*
+ **  Welch averaged power spectral density on top of WDLFFT
+ **
+ **  C++ wrapper (C)2024 DEMOS
+ **  GITHUB: https://github.com/mewza or Email: subband@protonmail.com
+ **  LICENSE: same as wdlfft.h
+ **
+ **  WDLFFT_Welch<S, V> streams S samples, cuts them into windowed frames
+ **  of len samples every hop, and accumulates |X[k]|^2 over all frames.
+ **
+ **  Frames are batched: with V a vector of L lanes of S (for example
+ **  WDLFFT_Welch<float, simd_float8>) L overlapping frames are transposed
+ **  into the lanes of one buffer (WDLFFT_Lanes tiles) and go through a
+ **  single WDLFFT<V> transform. The real_fft split pass is replaced by a
+ **  copy of two_for_one_pass that never stores the spectrum: each bin's
+ **  |X|^2 is formed as soon as the split produces it, the lanes are summed
+ **  and added to a double accumulator in WDL_fft_permute order. Only
+ **  get_psd / get_power gather into natural order and scale. WDLFFT<V>
+ **  needs its own DECL_WDLFFT when V != S.
+ **
+ **  A batch is taken as soon as L frames are complete; flush() runs the
+ **  remaining complete frames with the spare lanes zeroed.
+ */
+
+#pragma once
+
+#include "wdlfft_lanes.h"
+
+template <typename S, typename V = S>
+class WDLFFT_Welch {
+public:
+
+    static const int32_t L = (int32_t)(sizeof(V) / sizeof(S));
+
+    WDLFFT_Welch() : m_len(0), m_hop(0), m_win(0), m_work(0), m_acc(0), m_in(0), m_cap(0), m_fill(0),
+                     m_frames(0), m_wsum(0), m_wsq(0) { }
+    ~WDLFFT_Welch() { free_bufs(); }
+
+    /*
+     * len = frame size, a power of two in 4..32768; hop in 1..len.
+     * window[0..len-1], if given, replaces the default periodic Hann.
+     * Returns false on bad arguments.
+     */
+    bool init(int32_t len, int32_t hop, const double *window = 0)
+    {
+        int32_t i;
+        free_bufs();
+        if (len < 4 || len > (1 << FFT_MAXBITLEN) || (len & (len - 1)) || hop < 1 || hop > len) return false;
+
+        WDLFFT<V>::WDL_fft_init();
+
+        m_len = len;
+        m_hop = hop;
+        m_win = (V *) WDLFFT<V>::alloc_buffer(len / 2);
+        m_work = (V *) WDLFFT<V>::alloc_buffer(len / 2);
+        m_acc = new double[len / 2 + 1];
+
+        m_wsum = m_wsq = 0;
+        for (i = 0; i < len; i ++)
+        {
+            const double w = window ? window[i] : 0.5 - 0.5 * cos(2.0 * M_PI * i / len);
+            m_win[i] = (V) w;
+            m_wsum += w;
+            m_wsq += w * w;
+        }
+
+        // one batch spans (L-1)*hop + len samples; leave room for a few more
+        m_cap = (L - 1) * hop + len + 4 * L * hop;
+        m_in = new S[m_cap];
+        reset();
+        return true;
+    }
+
+    /* drops buffered input and the accumulated spectrum */
+    void reset()
+    {
+        if (!m_acc) return;
+        memset(m_acc, 0, (m_len / 2 + 1) * sizeof(double));
+        m_fill = 0;
+        m_frames = 0;
+    }
+
+    /* adds every frame of in that completes a batch, returns the frames added */
+    int32_t process(const S *in, int32_t n)
+    {
+        const int32_t span = (L - 1) * m_hop + m_len;
+        int32_t added = 0;
+
+        while (n > 0)
+        {
+            int32_t c = m_cap - m_fill;
+            if (c > n) c = n;
+            memcpy(m_in + m_fill, in, c * sizeof(S));
+            m_fill += c;
+            in += c;
+            n -= c;
+
+            int32_t base = 0;
+            while (base + span <= m_fill)
+            {
+                batch(m_in + base, L);
+                base += L * m_hop;
+                added += L;
+            }
+            drop(base);
+        }
+        return added;
+    }
+
+    /* adds the complete frames still buffered (fewer than L), returns how many */
+    int32_t flush()
+    {
+        const int32_t nf = m_fill >= m_len ? (m_fill - m_len) / m_hop + 1 : 0;
+        if (!nf) return 0;
+        batch(m_in, nf);
+        drop(nf * m_hop);
+        return nf;
+    }
+
+    int64_t frames() const { return m_frames; }
+    int32_t bins() const { return m_len / 2 + 1; }
+
+    /* sum of |X|^2 over all frames, slot WDL_fft_permute(len/2, k) for 0 < k < len/2, DC in [0], Nyquist in [len/2] */
+    const double *raw() const { return m_acc; }
+
+    /*
+     * One-sided power spectral density in units^2/Hz, dest[0..len/2]
+     * natural order: white noise of variance s2 reads s2 * 2 / fs.
+     */
+    void get_psd(double *dest, double fs) const
+    {
+        export_bins(dest, 1.0 / (fs * m_wsq));
+    }
+
+    /* one-sided power per bin, units^2: a sine of amplitude A reads A^2/2 at its bin */
+    void get_power(double *dest) const
+    {
+        export_bins(dest, 1.0 / (m_wsum * m_wsum));
+    }
+
+private:
+
+    // owns the window, work, accumulator and input buffers
+    WDLFFT_Welch(const WDLFFT_Welch &);
+    WDLFFT_Welch &operator=(const WDLFFT_Welch &);
+
+    /* frames at src, src + hop, ..; nf <= L */
+    void batch(const S *src, int32_t nf)
+    {
+        const S *rows[L];
+        int32_t l, i;
+        if (L == 1)
+        {
+            for (i = 0; i < m_len; i ++) m_work[i] = *(const V *)(src + i) * m_win[i];
+        } else
+        {
+            for (l = 0; l < L; l ++) rows[l] = src + (l < nf ? l : 0) * m_hop;
+            WDLFFT_Lanes<V, S>::interleave(m_work, rows, nf, m_len);
+            for (i = 0; i < m_len; i ++) m_work[i] *= m_win[i];
+        }
+
+        WDLFFT<V>::fft((cmplxT<V> *) m_work, m_len / 2, 0);
+        WDLFFT<V>::r2(m_work);
+        accumulate_pass(m_work, twiddles(m_len), WDLFFT<V>::WDL_fft_permute_tab(m_len / 2), m_len);
+        m_frames += nf;
+    }
+
+    void drop(int32_t n)
+    {
+        if (n <= 0) return;
+        memmove(m_in, m_in + n, (m_fill - n) * sizeof(S));
+        m_fill -= n;
+    }
+
+    static double lanes(const V &v)
+    {
+        const S *s = (const S *) &v;
+        double r = 0;
+        int32_t l;
+        for (l = 0; l < L; l ++) r += s[l];
+        return r;
+    }
+
+    /*
+     * WDLFFT<V>::two_for_one_pass, forward only, with the stores replaced
+     * by acc[pos] += sum over lanes of |X|^2 (values are 2*X as real_fft
+     * leaves them; get_psd / get_power take the factor out)
+     */
+    template <typename W>
+    void accumulate_pass(const V *buf, const W *d, const int32_t *permute, int32_t len)
+    {
+        const uint32_t half = (uint32_t) len >> 1, quart = half >> 1, eighth = quart >> 1;
+        const cmplxT<V> *b = (const cmplxT<V> *) buf;
+        uint32_t i, j;
+
+        cmplxT<V> tw, sum, diff;
+        V tw1, tw2, re, im;
+
+        m_acc[0] += lanes(b[0].re * b[0].re);
+        m_acc[half] += lanes(b[0].im * b[0].im);
+
+        for (i = 1; i < quart; ++i)
+        {
+            const cmplxT<V> &p = b[permute[i]], &q = b[permute[half - i]];
+
+            if (i < eighth)
+            {
+                j = i - 1;
+                tw.re = d[j].re;
+                tw.im = d[j].im;
+            } else if (i > eighth)
+            {
+                j = quart - i - 1;
+                tw.re = d[j].im;
+                tw.im = d[j].re;
+            } else
+            {
+                tw.re = tw.im = (V) M_SQRT1_2;
+            }
+            tw.re = -tw.re;
+
+            sum.re  = p.re + q.re;
+            sum.im  = p.im + q.im;
+            diff.re = p.re - q.re;
+            diff.im = p.im - q.im;
+
+            tw1 = tw.re * sum.im + tw.im * diff.re;
+            tw2 = tw.im * sum.im - tw.re * diff.re;
+
+            re = sum.re - tw1;
+            im = diff.im - tw2;
+            m_acc[permute[i]] += lanes(re * re + im * im);
+            re = sum.re + tw1;
+            im = diff.im + tw2;
+            m_acc[permute[half - i]] += lanes(re * re + im * im);
+        }
+
+        const cmplxT<V> &p = b[permute[quart]];
+        m_acc[permute[quart]] += lanes((p.re * p.re + p.im * p.im) * (V) 4);
+    }
+
+    static const typename WDLFFT<V>::twiddle_t *twiddles(int32_t len)
+    {
+        switch (len)
+        {
+#define TMP(x) case x: return WDLFFT<V>::d##x;
+            TMP(16) TMP(32) TMP(64) TMP(128) TMP(256) TMP(512) TMP(1024)
+            TMP(2048) TMP(4096) TMP(8192) TMP(16384) TMP(32768)
+#undef TMP
+        }
+        return 0; // 4 and 8 need none
+    }
+
+    /* dest[k] = m_acc[pos(k)] / frames * scale, doubled for 0 < k < len/2 and /4 for real_fft's gain */
+    void export_bins(double *dest, double scale) const
+    {
+        const int32_t half = m_len / 2;
+        const int32_t *perm = WDLFFT<V>::WDL_fft_permute_tab(half);
+        const double s = m_frames ? scale * 0.25 / (double) m_frames : 0;
+        int32_t k;
+
+        dest[0] = m_acc[0] * s;
+        for (k = 1; k < half; k ++) dest[k] = m_acc[perm[k]] * 2.0 * s;
+        dest[half] = m_acc[half] * s;
+    }
+
+    void free_bufs()
+    {
+        WDLFFT<V>::free_buffer(m_win);
+        WDLFFT<V>::free_buffer(m_work);
+        delete [] m_acc;
+        delete [] m_in;
+        m_win = m_work = 0;
+        m_acc = 0;
+        m_in = 0;
+        m_len = 0;
+    }
+
+    int32_t m_len, m_hop;
+    V *m_win, *m_work;
+    double *m_acc;              // permuted order, DC at [0], Nyquist at [len/2]
+    S *m_in;
+    int32_t m_cap, m_fill;
+    int64_t m_frames;
+    double m_wsum, m_wsq;
+};